@@ -0,0 +1,185 @@
+/*
+Parallel segmented decoding of memory-mapped recordings
+
+Copyright 2022 Ahmet Inan <inan@aicodix.de>
+*/
+
+#pragma once
+
+#include <new>
+#include <atomic>
+#include <thread>
+#include <vector>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "decode_server.hh"
+
+struct ArchiveMessage {
+	int64_t position;
+	float cfo;
+	int32_t mode;
+	uint8_t call[10];
+	uint8_t payload[171];
+};
+
+class MappedAudio {
+	void *map = MAP_FAILED;
+	size_t size = 0;
+
+	static uint32_t le(const uint8_t *bytes, int count) {
+		uint32_t value = 0;
+		for (int i = count - 1; i >= 0; --i)
+			value = (value << 8) | bytes[i];
+		return value;
+	}
+
+	bool wave(const uint8_t *bytes) {
+		bool format = false;
+		for (size_t offset = 12; offset + 8 <= size;) {
+			size_t length = le(bytes + offset + 4, 4);
+			const uint8_t *chunk = bytes + offset + 8;
+			if (!std::memcmp(bytes + offset, "fmt ", 4) && length >= 16 && offset + 8 + length <= size) {
+				int tag = le(chunk, 2);
+				channels = le(chunk + 2, 2);
+				rate = le(chunk + 4, 4);
+				format = (tag == 1 || tag == 0xfffe) && le(chunk + 14, 2) == 16 && (channels == 1 || channels == 2);
+			} else if (!std::memcmp(bytes + offset, "data", 4) && format) {
+				samples = reinterpret_cast<const int16_t *>(chunk);
+				frames = std::min(length, size - offset - 8) / (sizeof(int16_t) * channels);
+				return true;
+			}
+			offset += 8 + length + (length & 1);
+		}
+		return false;
+	}
+
+public:
+	const int16_t *samples = nullptr;
+	int64_t frames = 0;
+	int rate = 0;
+	int channels = 1;
+
+	~MappedAudio() {
+		if (map != MAP_FAILED)
+			munmap(map, size);
+	}
+
+	// WAV files bring their own rate, raw 16 bit mono files use raw_rate
+	bool open(const char *path, int raw_rate) {
+		int fd = ::open(path, O_RDONLY);
+		if (fd < 0)
+			return false;
+		struct stat info;
+		if (fstat(fd, &info) < 0 || info.st_size < 12) {
+			close(fd);
+			return false;
+		}
+		size = info.st_size;
+		map = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+		close(fd);
+		if (map == MAP_FAILED)
+			return false;
+		posix_madvise(map, size, POSIX_MADV_SEQUENTIAL);
+		const uint8_t *bytes = reinterpret_cast<const uint8_t *>(map);
+		if (!std::memcmp(bytes, "RIFF", 4) && !std::memcmp(bytes + 8, "WAVE", 4))
+			return wave(bytes);
+		samples = reinterpret_cast<const int16_t *>(map);
+		frames = size / sizeof(int16_t);
+		rate = raw_rate;
+		channels = 1;
+		return true;
+	}
+};
+
+class ArchiveScan {
+	static const int overlap_blocks = 16;
+	static const int flush_blocks = 4;
+	int threads;
+
+	struct Segment {
+		int64_t begin, core, end;
+		std::vector<ArchiveMessage> messages;
+	};
+
+	static void decode(DecoderInterface *decoder, const MappedAudio &audio, int channel_select, int16_t *pad, Segment &segment, bool last) {
+		int extended_length = (1280 * audio.rate / 8000) * 9 / 8;
+		int64_t blocks = (audio.frames + extended_length - 1) / extended_length;
+		int64_t end = last ? blocks + flush_blocks : segment.end;
+		decoder->reset();
+		for (int64_t block = segment.begin; block < end; ++block) {
+			const int16_t *samples = audio.samples + block * extended_length * audio.channels;
+			int64_t count = std::max<int64_t>(0, std::min<int64_t>(extended_length, audio.frames - block * extended_length));
+			if (count < extended_length) {
+				std::memset(pad, 0, sizeof(int16_t) * extended_length * audio.channels);
+				if (count > 0)
+					std::memcpy(pad, samples, sizeof(int16_t) * count * audio.channels);
+				samples = pad;
+			}
+			if (!decoder->feed(samples, extended_length, channel_select))
+				continue;
+			for (int status = decoder->process(); status != STATUS_OKAY; status = decoder->process()) {
+				if (block < segment.core || (status != STATUS_DONE && status != STATUS_PING))
+					continue;
+				ArchiveMessage message = {};
+				message.position = (block + 1) * extended_length;
+				decoder->staged(&message.cfo, &message.mode, message.call);
+				if (status == STATUS_DONE && decoder->fetch(message.payload) < 0)
+					continue;
+				segment.messages.push_back(message);
+			}
+		}
+	}
+
+	static void work(const MappedAudio *audio, int channel_select, Segment *segments, int count, std::atomic<int> *next) {
+		int extended_length = (1280 * audio->rate / 8000) * 9 / 8;
+		DecoderInterface *decoder = create_decoder(audio->rate);
+		int16_t *pad = new(std::nothrow) int16_t[extended_length * audio->channels];
+		if (decoder && pad)
+			for (int i = (*next)++; i < count; i = (*next)++)
+				decode(decoder, *audio, channel_select, pad, segments[i], i == count - 1);
+		delete[] pad;
+		delete decoder;
+	}
+
+public:
+	ArchiveScan(int threads) : threads(std::max(threads, 1)) {}
+
+	// messages come in order of position, each owned by the segment whose core saw it complete
+	bool operator()(std::vector<ArchiveMessage> &messages, const MappedAudio &audio, int channel_select) {
+		if (audio.rate <= 0 || !audio.frames)
+			return false;
+		DecoderInterface *probe = create_decoder(audio.rate);
+		if (!probe)
+			return false;
+		delete probe;
+		if (audio.channels == 2 && !channel_select)
+			channel_select = 1;
+		if (audio.channels == 1)
+			channel_select = 0;
+		int extended_length = (1280 * audio.rate / 8000) * 9 / 8;
+		int64_t blocks = (audio.frames + extended_length - 1) / extended_length;
+		int64_t core = std::max<int64_t>((blocks + 4 * threads - 1) / (4 * threads), 4 * overlap_blocks);
+		int count = (blocks + core - 1) / core;
+		std::vector<Segment> segments(count);
+		for (int i = 0; i < count; ++i) {
+			segments[i].core = i * core;
+			segments[i].begin = std::max<int64_t>(0, i * core - overlap_blocks);
+			segments[i].end = std::min(blocks, (i + 1) * core);
+		}
+		std::atomic<int> next(0);
+		std::vector<std::thread> workers;
+		for (int i = 1; i < std::min(threads, count); ++i)
+			workers.emplace_back(work, &audio, channel_select, segments.data(), count, &next);
+		work(&audio, channel_select, segments.data(), count, &next);
+		for (std::thread &worker: workers)
+			worker.join();
+		messages.clear();
+		for (Segment &segment: segments)
+			messages.insert(messages.end(), segment.messages.begin(), segment.messages.end());
+		return true;
+	}
+};
+
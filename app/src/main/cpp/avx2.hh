@@ -470,6 +470,22 @@ inline SIMD<double, 4> vmul(SIMD<double, 4> a, SIMD<double, 4> b)
 	return tmp;
 }
 
+template <>
+inline SIMD<float, 8> vdiv(SIMD<float, 8> a, SIMD<float, 8> b)
+{
+	SIMD<float, 8> tmp;
+	tmp.m = _mm256_div_ps(a.m, b.m);
+	return tmp;
+}
+
+template <>
+inline SIMD<double, 4> vdiv(SIMD<double, 4> a, SIMD<double, 4> b)
+{
+	SIMD<double, 4> tmp;
+	tmp.m = _mm256_div_pd(a.m, b.m);
+	return tmp;
+}
+
 template <>
 inline SIMD<float, 8> vabs(SIMD<float, 8> a)
 {
@@ -1194,3 +1210,27 @@ inline SIMD<float, 8> vshuf(SIMD<float, 8> a, SIMD<uint32_t, 8> b)
 	return tmp;
 }
 
+template <>
+inline SIMD<int32_t, 8> vcvtn(SIMD<float, 8> a)
+{
+	SIMD<int32_t, 8> tmp;
+	tmp.m = _mm256_cvtps_epi32(a.m);
+	return tmp;
+}
+
+template <>
+inline SIMD<float, 8> vcvt(SIMD<int32_t, 8> a)
+{
+	SIMD<float, 8> tmp;
+	tmp.m = _mm256_cvtepi32_ps(a.m);
+	return tmp;
+}
+
+template <>
+inline SIMD<int16_t, 16> vqmovn(SIMD<int32_t, 8> a, SIMD<int32_t, 8> b)
+{
+	SIMD<int16_t, 16> tmp;
+	tmp.m = _mm256_permute4x64_epi64(_mm256_packs_epi32(a.m, b.m), 0xd8);
+	return tmp;
+}
+
@@ -0,0 +1,118 @@
+/*
+Headless batch encoder for Linux
+
+Copyright 2022 Ahmet Inan <inan@aicodix.de>
+*/
+
+#include <cassert>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <algorithm>
+#include <string>
+#include <thread>
+#include <vector>
+#include <unistd.h>
+#include "batch_encoder.hh"
+
+static void usage(const char *name) {
+	fprintf(stderr, "usage: %s [-r RATE] [-t THREADS] [-c CHANNEL] [-p PASSES] [-g SECONDS] < JOBS > AUDIO\n", name);
+	fprintf(stderr, "one job per line: call carrier noise fancy [message], an empty message sends a ping\n");
+	fprintf(stderr, "the call has up to nine letters and digits\n");
+	fprintf(stderr, "writes the bursts as 16 bit PCM in job order, each followed by SECONDS of silence\n");
+}
+
+struct Line {
+	std::string call, message;
+	int carrier, noise, fancy;
+};
+
+static bool parse(Line &line, const char *text) {
+	char call[16];
+	int length = 0;
+	if (sscanf(text, "%15s %d %d %d%n", call, &line.carrier, &line.noise, &line.fancy, &length) != 4)
+		return false;
+	// the metadata only has room for nine base37 digits
+	if (std::strlen(call) > 9 || std::strspn(call, "0123456789ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz") != std::strlen(call))
+		return false;
+	text += length;
+	if (*text == ' ')
+		++text;
+	line.call = call;
+	// the encoder reads the whole 170 bytes of payload
+	line.message.assign(text, std::min<size_t>(std::strcspn(text, "\n"), 170));
+	line.message.resize(170);
+	return true;
+}
+
+static bool flush(BatchEncoder &encoder, std::vector<Line> &lines, int channel_select, int papr_iterations, const std::vector<int16_t> &gap) {
+	std::vector<EncoderJob> jobs(lines.size());
+	for (size_t i = 0; i < lines.size(); ++i) {
+		jobs[i].payload = reinterpret_cast<const uint8_t *>(lines[i].message.c_str());
+		jobs[i].call_sign = reinterpret_cast<const int8_t *>(lines[i].call.c_str());
+		jobs[i].carrier_frequency = lines[i].carrier;
+		jobs[i].noise_symbols = lines[i].noise;
+		jobs[i].fancy_header = lines[i].fancy;
+		jobs[i].papr_iterations = papr_iterations;
+	}
+	if (!encoder(jobs.data(), jobs.size(), channel_select))
+		return false;
+	for (const EncoderJob &job: jobs)
+		if (fwrite(job.audio.data(), sizeof(int16_t), job.audio.size(), stdout) != job.audio.size()
+				|| fwrite(gap.data(), sizeof(int16_t), gap.size(), stdout) != gap.size())
+			return false;
+	lines.clear();
+	return !fflush(stdout);
+}
+
+int main(int argc, char **argv) {
+	int rate = 8000;
+	int threads = std::thread::hardware_concurrency();
+	int channel_select = 0;
+	int papr_iterations = 1;
+	float silence = 1;
+	for (int opt; (opt = getopt(argc, argv, "r:t:c:p:g:h")) != -1;) {
+		switch (opt) {
+			case 'r':
+				rate = std::atoi(optarg);
+				break;
+			case 't':
+				threads = std::atoi(optarg);
+				break;
+			case 'c':
+				channel_select = std::atoi(optarg);
+				break;
+			case 'p':
+				papr_iterations = std::atoi(optarg);
+				break;
+			case 'g':
+				silence = std::atof(optarg);
+				break;
+			default:
+				usage(argv[0]);
+				return 1;
+		}
+	}
+	threads = std::max(threads, 1);
+	BatchEncoder encoder(rate, threads);
+	if (!encoder.okay()) {
+		fprintf(stderr, "unsupported rate %d\n", rate);
+		return 1;
+	}
+	std::vector<int16_t> gap(EncoderInterface::channels(channel_select) * int(std::max(silence, 0.f) * rate));
+	std::vector<Line> lines;
+	char text[256];
+	for (int number = 1; fgets(text, sizeof(text), stdin); ++number) {
+		Line line;
+		if (!parse(line, text)) {
+			fprintf(stderr, "skipping malformed job on line %d\n", number);
+			continue;
+		}
+		lines.push_back(line);
+		// keep every thread busy while the first bursts are already written out
+		if (lines.size() >= 4 * size_t(threads) && !flush(encoder, lines, channel_select, papr_iterations, gap))
+			return 1;
+	}
+	return !flush(encoder, lines, channel_select, papr_iterations, gap);
+}
@@ -0,0 +1,84 @@
+/*
+Batch encoder for COFDMTV
+
+Copyright 2022 Ahmet Inan <inan@aicodix.de>
+*/
+
+#pragma once
+
+#include <new>
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <vector>
+#include "encoder.hh"
+
+static EncoderInterface *create_encoder(int rate) {
+	switch (rate) {
+		case 8000:
+			return new(std::nothrow) Encoder<8000>();
+		case 16000:
+			return new(std::nothrow) Encoder<16000>();
+		case 32000:
+			return new(std::nothrow) Encoder<32000>();
+		case 44100:
+			return new(std::nothrow) Encoder<44100>();
+		case 48000:
+			return new(std::nothrow) Encoder<48000>();
+	}
+	return nullptr;
+}
+
+struct EncoderJob {
+	const uint8_t *payload;
+	const int8_t *call_sign;
+	int carrier_frequency;
+	int noise_symbols;
+	bool fancy_header;
+	int papr_iterations;
+	std::vector<int16_t> audio;
+};
+
+// every thread keeps its encoder and with it the symbol cache across batches
+class BatchEncoder {
+	std::vector<EncoderInterface *> encoders;
+
+	static void work(EncoderInterface *encoder, EncoderJob *jobs, int count, int channel_select, std::atomic<int> *next) {
+		for (int i = (*next)++; i < count; i = (*next)++) {
+			EncoderJob &job = jobs[i];
+			encoder->configure(job.payload, job.call_sign, job.carrier_frequency, job.noise_symbols, job.fancy_header, job.papr_iterations);
+			job.audio.resize(EncoderInterface::channels(channel_select) * encoder->length());
+			encoder->render(job.audio.data(), channel_select);
+		}
+	}
+
+public:
+	BatchEncoder(int rate, int threads) : encoders(std::max(threads, 1)) {
+		for (auto &encoder: encoders)
+			encoder = create_encoder(rate);
+	}
+
+	~BatchEncoder() {
+		for (auto encoder: encoders)
+			delete encoder;
+	}
+
+	bool okay() {
+		return std::all_of(encoders.begin(), encoders.end(), [](EncoderInterface *encoder) { return encoder != nullptr; });
+	}
+
+	// renders all jobs, their audio stays in the order given
+	bool operator()(EncoderJob *jobs, int count, int channel_select) {
+		if (!okay())
+			return false;
+		std::atomic<int> next(0);
+		int threads = std::min<int>(encoders.size(), count);
+		std::vector<std::thread> pool;
+		for (int i = 1; i < threads; ++i)
+			pool.emplace_back(work, encoders[i], jobs, count, channel_select, &next);
+		work(encoders[0], jobs, count, channel_select, &next);
+		for (auto &thread: pool)
+			thread.join();
+		return true;
+	}
+};
@@ -14,10 +14,16 @@ class BipBuffer
 	TYPE buf[2*NUM];
 	int pos0, pos1;
 public:
-	BipBuffer() : pos0(0), pos1(NUM)
+	BipBuffer()
+	{
+		reset();
+	}
+	void reset()
 	{
 		for (int i = 0; i < 2*NUM; ++i)
 			buf[i] = 0;
+		pos0 = 0;
+		pos1 = NUM;
 	}
 	const TYPE *operator () ()
 	{
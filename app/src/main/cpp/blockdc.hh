@@ -22,6 +22,10 @@ public:
 		a = VALUE(s - 1) / VALUE(s);
 		b = (VALUE(1) + a) / VALUE(2);
 	}
+	void reset()
+	{
+		x1 = y1 = 0;
+	}
 	TYPE operator()(TYPE x0)
 	{
 		TYPE y0 = b * (x0 - x1) + a * y1;
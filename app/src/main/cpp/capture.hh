@@ -0,0 +1,121 @@
+/*
+Triggered capture of raw decoder input
+
+Copyright 2022 Ahmet Inan <inan@aicodix.de>
+*/
+
+#pragma once
+
+#include <cstdio>
+#include <cstdint>
+#include <cstring>
+#include "bip_buffer.hh"
+
+#define CAPTURE_FAIL 1
+#define CAPTURE_SYNC 2
+#define CAPTURE_POLAR 4
+
+struct CaptureHeader {
+	char magic[4];
+	int32_t rate;
+	int32_t channels;
+	int32_t channel_select;
+	int32_t trigger;
+	int32_t mode;
+	int32_t position;
+	float cfo;
+	uint64_t call;
+	int32_t frames;
+	int32_t reserved;
+};
+
+template<int RATE, int FRAMES>
+class Capture {
+	DSP::BipBuffer<int16_t, 2 * FRAMES> ring;
+	CaptureHeader header;
+	char directory[256];
+	int64_t recorded = 0;
+	int64_t position = 0;
+	int channel_select = -1;
+	int channels = 1;
+	int pending = -1;
+	int serial = 0;
+
+	void dump() {
+		int frames = 2 * FRAMES / channels;
+		if (recorded < frames)
+			frames = recorded;
+		std::memcpy(header.magic, "RGC1", 4);
+		header.rate = RATE;
+		header.channels = channels;
+		header.channel_select = channel_select;
+		header.position = position - (recorded - frames);
+		header.frames = frames;
+		header.reserved = 0;
+		char path[sizeof(directory) + 32];
+		snprintf(path, sizeof(path), "%s/capture-%d-%04d.rgc", directory, RATE, serial++);
+		FILE *file = fopen(path, "wb");
+		if (!file)
+			return;
+		fwrite(&header, sizeof(header), 1, file);
+		fwrite(ring() + 2 * FRAMES - frames * channels, sizeof(int16_t), frames * channels, file);
+		fclose(file);
+	}
+
+public:
+	int triggers = 0;
+
+	bool open(const char *path, int mask) {
+		if (std::strlen(path) >= sizeof(directory))
+			return false;
+		std::strcpy(directory, path);
+		triggers = mask;
+		pending = -1;
+		return true;
+	}
+
+	void reset() {
+		channel_select = -1;
+		recorded = 0;
+		pending = -1;
+	}
+
+	int64_t count() {
+		return recorded;
+	}
+
+	void operator()(const int16_t *samples, int sample_count, int select) {
+		if (select != channel_select) {
+			channel_select = select;
+			channels = select ? 2 : 1;
+			recorded = 0;
+			pending = -1;
+		}
+		for (int i = 0; i < sample_count * channels; ++i)
+			ring(samples[i]);
+		recorded += sample_count;
+		if (pending >= 0 && (pending -= sample_count) <= 0) {
+			pending = -1;
+			dump();
+		}
+	}
+
+	void trigger(int reason, int after, int mode, float cfo, uint64_t call, int64_t offset) {
+		if (!(triggers & reason))
+			return;
+		if (pending < 0) {
+			pending = after;
+			header.trigger = 0;
+		}
+		header.trigger |= reason;
+		header.mode = mode;
+		header.cfo = cfo;
+		header.call = call;
+		position = recorded + offset;
+		if (!pending) {
+			pending = -1;
+			dump();
+		}
+	}
+};
+
@@ -0,0 +1,166 @@
+/*
+Headless multi-stream decoder for Linux
+
+Copyright 2022 Ahmet Inan <inan@aicodix.de>
+*/
+
+#include <cassert>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <algorithm>
+#include <new>
+#include <string>
+#include <thread>
+#include <vector>
+#include <unistd.h>
+#include "decode_server.hh"
+#include "archive_scan.hh"
+#include "frame_search.hh"
+
+static void usage(const char *name) {
+	fprintf(stderr, "usage: %s [-r RATE] [-t THREADS] [-s SECONDS] [-l SOCKET] [-q | -m | -i FORMAT:IQRATE [-F HZ]] [FILE|FIFO|-]...\n", name);
+	fprintf(stderr, "decodes 16 bit mono PCM streams, one message per line: stream call mode cfo payload\n");
+	fprintf(stderr, "with -q PCM streams run through the fixed point front end\n");
+	fprintf(stderr, "with -m every %d consecutive streams share the SIMD lanes of one decoder and advance in lock-step\n", multi_lanes);
+	fprintf(stderr, "with -i cu8|cs16|cf32:IQRATE streams are interleaved I/Q resampled to RATE, -F HZ shifts them first\n");
+	fprintf(stderr, "   or: %s -o [-f] [-r RATE] [-t THREADS] [-c CHANNEL] FILE...\n", name);
+	fprintf(stderr, "scans raw or WAV recordings in parallel segments: file seconds call mode cfo payload\n");
+	fprintf(stderr, "with -f a bulk frame search runs first and only its candidates are decoded\n");
+}
+
+static bool search(std::vector<ArchiveMessage> &messages, const MappedAudio &audio, int channel_select) {
+	FrameSearchInterface *search = create_search(audio.rate);
+	if (!search || !audio.frames) {
+		delete search;
+		return false;
+	}
+	std::vector<FrameCandidate> candidates;
+	search->search(candidates, audio, channel_select);
+	search->decode(messages, candidates, audio, channel_select);
+	delete search;
+	return true;
+}
+
+static int offline(int argc, char **argv, int rate, int threads, int channel_select, bool fast) {
+	ArchiveScan scan(threads);
+	std::vector<ArchiveMessage> messages;
+	int result = 0;
+	for (int i = 0; i < argc; ++i) {
+		MappedAudio audio;
+		if (!audio.open(argv[i], rate) || !(fast ? search(messages, audio, channel_select) : scan(messages, audio, channel_select))) {
+			fprintf(stderr, "could not scan %s\n", argv[i]);
+			result = 1;
+			continue;
+		}
+		for (const ArchiveMessage &message: messages) {
+			const char *sign = reinterpret_cast<const char *>(message.call);
+			while (*sign == ' ')
+				++sign;
+			printf("%s %.3f %s %d %+.1f %s\n", argv[i], double(message.position) / audio.rate,
+				sign, message.mode, message.cfo, message.payload);
+		}
+	}
+	return result;
+}
+
+int main(int argc, char **argv) {
+	int rate = 8000;
+	int threads = std::thread::hardware_concurrency();
+	int interval = 10;
+	int channel_select = 0;
+	bool archive = false;
+	bool fast = false;
+	bool lanes = false;
+	bool fixed = false;
+	const char *socket_path = nullptr;
+	int iq_format = -1, iq_rate = 0;
+	float iq_frequency = 0;
+	for (int opt; (opt = getopt(argc, argv, "r:t:s:l:c:i:F:qmofh")) != -1;) {
+		switch (opt) {
+			case 'r':
+				rate = std::atoi(optarg);
+				break;
+			case 't':
+				threads = std::atoi(optarg);
+				break;
+			case 's':
+				interval = std::atoi(optarg);
+				break;
+			case 'l':
+				socket_path = optarg;
+				break;
+			case 'c':
+				channel_select = std::atoi(optarg);
+				break;
+			case 'i': {
+				const char *colon = std::strchr(optarg, ':');
+				std::string name(optarg, colon ? colon - optarg : std::strlen(optarg));
+				iq_format = IQInput::parse(name.c_str());
+				iq_rate = colon ? std::atoi(colon + 1) : 0;
+				if (iq_format < 0 || iq_rate <= 0) {
+					fprintf(stderr, "unsupported I/Q input %s\n", optarg);
+					return 1;
+				}
+				break;
+			}
+			case 'F':
+				iq_frequency = std::atof(optarg);
+				break;
+			case 'q':
+				fixed = true;
+				break;
+			case 'm':
+				lanes = true;
+				break;
+			case 'o':
+				archive = true;
+				break;
+			case 'f':
+				fast = true;
+				break;
+			default:
+				usage(argv[0]);
+				return 1;
+		}
+	}
+	DecoderInterface *probe = create_decoder(rate);
+	if (!probe) {
+		fprintf(stderr, "unsupported rate %d\n", rate);
+		return 1;
+	}
+	delete probe;
+	if (archive && optind < argc)
+		return offline(argc - optind, argv + optind, rate, std::max(threads, 1), channel_select, fast);
+	if (archive || (!socket_path && optind >= argc) || (lanes && iq_format >= 0) || (fixed && (lanes || iq_format >= 0))) {
+		usage(argv[0]);
+		return 1;
+	}
+	auto server = new(std::nothrow) DecodeServer(rate, fixed);
+	if (!server || !server->start(std::max(threads, 1), lanes)) {
+		fprintf(stderr, "could not start server\n");
+		return 1;
+	}
+	if (iq_format >= 0 && !server->input(iq_format, iq_rate, iq_frequency)) {
+		if (!DSP::Resampler<DSP::Complex<float>>::supported(iq_rate, rate))
+			fprintf(stderr, "I/Q rate %d Hz has no small enough ratio to %d Hz for resampling, try a rounder rate\n", iq_rate, rate);
+		else
+			fprintf(stderr, "could not set up I/Q input at %d Hz\n", iq_rate);
+		delete server;
+		return 1;
+	}
+	if (socket_path && !server->listen(socket_path)) {
+		fprintf(stderr, "could not listen on %s\n", socket_path);
+		delete server;
+		return 1;
+	}
+	for (int i = optind; i < argc; ++i) {
+		int fd = std::strcmp(argv[i], "-") ? open(argv[i], O_RDONLY | O_NONBLOCK) : dup(STDIN_FILENO);
+		if (fd < 0 || server->add(fd) < 0)
+			fprintf(stderr, "could not add stream %s\n", argv[i]);
+	}
+	server->run(interval);
+	delete server;
+	return 0;
+}
+
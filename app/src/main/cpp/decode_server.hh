@@ -0,0 +1,580 @@
+/*
+Multi-stream decode server on a work stealing thread pool
+
+Copyright 2022 Ahmet Inan <inan@aicodix.de>
+*/
+
+#pragma once
+
+#include <new>
+#include <mutex>
+#include <deque>
+#include <atomic>
+#include <thread>
+#include <vector>
+#include <chrono>
+#include <cerrno>
+#include <cstdio>
+#include <functional>
+#include <condition_variable>
+#include <poll.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/un.h>
+#include <sys/stat.h>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+#include <sys/eventfd.h>
+#include "decoder.hh"
+#include "multi_decoder.hh"
+#include "iq_input.hh"
+
+class WorkStealingPool {
+	struct Queue {
+		std::mutex lock;
+		std::deque<int> tasks;
+	};
+	std::function<void(int)> run;
+	std::vector<std::thread> workers;
+	std::mutex idle_lock;
+	std::condition_variable idle;
+	Queue *queues = nullptr;
+	std::atomic<int> pending{0};
+	std::atomic<int> next{0};
+	bool running = false;
+	int count = 0;
+
+	bool take(int self, int *task) {
+		for (int i = 0; i < count; ++i) {
+			Queue &queue = queues[(self + i) % count];
+			std::lock_guard<std::mutex> guard(queue.lock);
+			if (queue.tasks.empty())
+				continue;
+			if (i) {
+				*task = queue.tasks.front();
+				queue.tasks.pop_front();
+			} else {
+				*task = queue.tasks.back();
+				queue.tasks.pop_back();
+			}
+			--pending;
+			return true;
+		}
+		return false;
+	}
+
+	void work(int self) {
+		while (true) {
+			int task;
+			if (take(self, &task)) {
+				run(task);
+				continue;
+			}
+			std::unique_lock<std::mutex> guard(idle_lock);
+			idle.wait(guard, [this] { return pending > 0 || !running; });
+			if (!running && pending <= 0)
+				return;
+		}
+	}
+
+public:
+	~WorkStealingPool() {
+		stop();
+	}
+
+	bool start(int threads, std::function<void(int)> func) {
+		queues = new(std::nothrow) Queue[threads];
+		if (!queues)
+			return false;
+		count = threads;
+		run = func;
+		running = true;
+		for (int i = 0; i < threads; ++i)
+			workers.emplace_back(&WorkStealingPool::work, this, i);
+		return true;
+	}
+
+	void push(int task) {
+		Queue &queue = queues[next++ % count];
+		{
+			std::lock_guard<std::mutex> guard(queue.lock);
+			queue.tasks.push_back(task);
+		}
+		{
+			std::lock_guard<std::mutex> guard(idle_lock);
+			++pending;
+		}
+		idle.notify_one();
+	}
+
+	void stop() {
+		{
+			std::lock_guard<std::mutex> guard(idle_lock);
+			running = false;
+		}
+		idle.notify_all();
+		for (std::thread &worker: workers)
+			worker.join();
+		workers.clear();
+		delete[] queues;
+		queues = nullptr;
+		count = 0;
+	}
+};
+
+struct ServerStream {
+	DecoderInterface *decoder = nullptr;
+	IQInput *iq = nullptr;
+	int16_t *audio = nullptr;
+	std::chrono::steady_clock::time_point started;
+	std::atomic<int64_t> samples{0};
+	std::atomic<int64_t> nanos{0};
+	std::atomic<int> messages{0};
+	std::atomic<bool> busy{false};
+	std::atomic<bool> closed{false};
+	std::atomic<bool> readable{false};
+	int fd = -1;
+	int filled = 0;
+	int tail = 0;
+};
+
+// streams sharing one MultiDecoder, fed in lock-step
+struct LaneGroup {
+	MultiDecoderInterface *decoder = nullptr;
+	int16_t *audio = nullptr;
+	std::atomic<bool> busy{false};
+
+	~LaneGroup() {
+		delete decoder;
+		delete[] audio;
+	}
+};
+
+class DecodeServer {
+	typedef std::chrono::steady_clock clock;
+	static const int stream_count = 256;
+	static const int block_budget = 16;
+	static const int iq_chunk = 4096;
+	WorkStealingPool pool;
+	std::mutex output;
+	ServerStream streams[stream_count];
+	LaneGroup *groups = nullptr;
+	int rate, extended_length;
+	bool fixed = false;
+	int iq_format = -1, iq_rate = 0;
+	float iq_frequency = 0;
+	int listener = -1;
+	int wake = -1;
+
+	void report(int id, ServerStream &stream, int status) {
+		float cfo = 0;
+		int32_t mode = 0;
+		uint8_t call[10] = {0};
+		uint8_t payload[171] = {0};
+		if (status != STATUS_DONE && status != STATUS_PING)
+			return;
+		stream.decoder->staged(&cfo, &mode, call);
+		if (status == STATUS_DONE) {
+			if (stream.decoder->fetch(payload) < 0)
+				return;
+			++stream.messages;
+		}
+		const char *sign = reinterpret_cast<char *>(call);
+		while (*sign == ' ')
+			++sign;
+		std::lock_guard<std::mutex> guard(output);
+		printf("%d %s %d %+.1f %s\n", id, sign, mode, cfo, payload);
+		fflush(stdout);
+	}
+
+	static void elapsed(ServerStream &stream, clock::time_point start) {
+		stream.nanos += std::chrono::duration_cast<std::chrono::nanoseconds>(clock::now() - start).count();
+	}
+
+	// I/Q streams hand in resampled samples, the time spent converting them counts too
+	void decode(int id, ServerStream &stream, const DSP::Complex<float> *samples = nullptr) {
+		clock::time_point start = clock::now();
+		if (samples ? stream.decoder->feed(samples, extended_length) : stream.decoder->feed(stream.audio, extended_length, 0))
+			for (int status = stream.decoder->process(); status != STATUS_OKAY; status = stream.decoder->process())
+				report(id, stream, status);
+		if (!samples)
+			elapsed(stream, start);
+		stream.samples += extended_length;
+	}
+
+	void flush(int id, ServerStream &stream) {
+		if (stream.iq) {
+			clock::time_point start = clock::now();
+			stream.iq->flush(4, [&](const DSP::Complex<float> *samples) { decode(id, stream, samples); });
+			elapsed(stream, start);
+			return;
+		}
+		int bytes = sizeof(int16_t) * extended_length;
+		std::memset(reinterpret_cast<char *>(stream.audio) + stream.filled, 0, bytes - stream.filled);
+		decode(id, stream);
+		std::memset(stream.audio, 0, bytes);
+		for (int i = 0; i < 4; ++i)
+			decode(id, stream);
+	}
+
+	void serve_iq(int id) {
+		ServerStream &stream = streams[id];
+		uint8_t chunk[iq_chunk];
+		int blocks = 0;
+		auto func = [&](const DSP::Complex<float> *samples) {
+			decode(id, stream, samples);
+			++blocks;
+		};
+		while (blocks < block_budget) {
+			ssize_t got = read(stream.fd, chunk, iq_chunk);
+			if (got < 0 && errno == EINTR)
+				continue;
+			if (got < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+				break;
+			if (got <= 0) {
+				flush(id, stream);
+				stream.closed = true;
+				break;
+			}
+			clock::time_point start = clock::now();
+			(*stream.iq)(chunk, got, func);
+			elapsed(stream, start);
+		}
+	}
+
+	void serve_pcm(int id) {
+		ServerStream &stream = streams[id];
+		int bytes = sizeof(int16_t) * extended_length;
+		for (int blocks = 0; blocks < block_budget;) {
+			ssize_t got = read(stream.fd, reinterpret_cast<char *>(stream.audio) + stream.filled, bytes - stream.filled);
+			if (got < 0 && errno == EINTR)
+				continue;
+			if (got < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+				break;
+			if (got <= 0) {
+				flush(id, stream);
+				stream.closed = true;
+				break;
+			}
+			stream.filled += got;
+			if (stream.filled == bytes) {
+				decode(id, stream);
+				stream.filled = 0;
+				++blocks;
+			}
+		}
+	}
+
+	// every lane of a group holds one block, idle and ended lanes get zeros
+	void decode_group(int group) {
+		clock::time_point start = clock::now();
+		ServerStream *lanes = streams + group * multi_lanes;
+		int16_t *audio = groups[group].audio;
+		int live = 0, mask = 0;
+		for (int k = 0; k < multi_lanes; ++k) {
+			ServerStream &stream = lanes[k];
+			bool fed = stream.fd >= 0 && !stream.closed && stream.filled;
+			for (int i = 0; i < extended_length; ++i)
+				audio[multi_lanes * i + k] = fed ? stream.audio[i] : 0;
+			if (stream.fd >= 0 && !stream.closed) {
+				mask |= 1 << k;
+				++live;
+			}
+		}
+		groups[group].decoder->feed(audio, extended_length, mask);
+		for (int k = 0; k < multi_lanes; ++k) {
+			ServerStream &stream = lanes[k];
+			if (stream.fd < 0 || stream.closed)
+				continue;
+			for (int status = stream.decoder->process(); status != STATUS_OKAY; status = stream.decoder->process())
+				report(group * multi_lanes + k, stream, status);
+			stream.samples += extended_length;
+			if (stream.filled)
+				stream.filled = 0;
+			else if (!--stream.tail)
+				stream.closed = true;
+		}
+		int64_t nanos = std::chrono::duration_cast<std::chrono::nanoseconds>(clock::now() - start).count();
+		for (int k = 0; k < multi_lanes; ++k)
+			if (mask & (1 << k))
+				lanes[k].nanos += nanos / live;
+	}
+
+	// a lane that has no full block yet holds back the whole group, only lanes that polled readable are read
+	// as a FIFO without a writer reads like its end
+	void serve_group(int group) {
+		ServerStream *lanes = streams + group * multi_lanes;
+		int bytes = sizeof(int16_t) * extended_length;
+		for (int blocks = 0; blocks < block_budget; ++blocks) {
+			bool active = false, waiting = false;
+			for (int k = 0; k < multi_lanes; ++k) {
+				ServerStream &stream = lanes[k];
+				if (stream.fd < 0 || stream.closed)
+					continue;
+				active = true;
+				while (!stream.tail && stream.filled < bytes && stream.readable) {
+					ssize_t got = read(stream.fd, reinterpret_cast<char *>(stream.audio) + stream.filled, bytes - stream.filled);
+					if (got < 0 && errno == EINTR)
+						continue;
+					if (got < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+						stream.readable = false;
+						break;
+					}
+					if (got <= 0) {
+						std::memset(reinterpret_cast<char *>(stream.audio) + stream.filled, 0, bytes - stream.filled);
+						stream.filled = bytes;
+						stream.tail = 4;
+						break;
+					}
+					stream.filled += got;
+				}
+				waiting |= !stream.tail && stream.filled < bytes;
+			}
+			if (!active || waiting)
+				break;
+			decode_group(group);
+		}
+	}
+
+	// in lane groups nothing has to be read while every stream holds a block or is ending
+	bool ready(int group) {
+		bool active = false;
+		for (int k = 0; k < multi_lanes; ++k) {
+			ServerStream &stream = streams[group * multi_lanes + k];
+			if (stream.fd < 0 || stream.closed)
+				continue;
+			if (!stream.tail && stream.filled < int(sizeof(int16_t)) * extended_length)
+				return false;
+			active = true;
+		}
+		return active;
+	}
+
+	std::atomic<bool> &busy(int id) {
+		return groups ? groups[id / multi_lanes].busy : streams[id].busy;
+	}
+
+	void serve(int id) {
+		ServerStream &stream = streams[id];
+		if (groups)
+			serve_group(id / multi_lanes);
+		else if (stream.iq)
+			serve_iq(id);
+		else
+			serve_pcm(id);
+		busy(id) = false;
+		uint64_t one = 1;
+		if (write(wake, &one, sizeof(one)) < 0)
+			return;
+	}
+
+	// in seconds of input not read yet
+	double backlog(ServerStream &stream) {
+		struct stat info;
+		int pending = 0;
+		double byte_rate = stream.iq ? double(stream.iq->bytes_per_sample()) * stream.iq->rate() : double(sizeof(int16_t)) * rate;
+		if (!fstat(stream.fd, &info) && S_ISREG(info.st_mode))
+			return (info.st_size - lseek(stream.fd, 0, SEEK_CUR)) / byte_rate;
+		if (ioctl(stream.fd, FIONREAD, &pending) < 0)
+			return 0;
+		return pending / byte_rate;
+	}
+
+	void statistics(int id, ServerStream &stream) {
+		int64_t samples = stream.samples;
+		double audio = double(samples) / rate;
+		double busy = stream.nanos / 1e9;
+		double late = backlog(stream);
+		double wall = std::chrono::duration<double>(clock::now() - stream.started).count();
+		std::lock_guard<std::mutex> guard(output);
+		fprintf(stderr, "stream %d: %.1f s audio in %.1f s, real-time factor %.3f, backlog %.2f s, %d messages\n",
+			id, audio, wall, audio > 0 ? busy / audio : 0, late, int(stream.messages));
+	}
+
+	void release(int id) {
+		ServerStream &stream = streams[id];
+		statistics(id, stream);
+		close(stream.fd);
+		if (!groups)
+			delete stream.decoder;
+		delete stream.iq;
+		delete[] stream.audio;
+		stream.decoder = nullptr;
+		stream.iq = nullptr;
+		stream.audio = nullptr;
+		stream.fd = -1;
+		stream.closed = false;
+		stream.tail = 0;
+	}
+
+public:
+	DecodeServer(int rate, bool fixed = false) : rate(rate), extended_length((1280 * rate / 8000) * 9 / 8), fixed(fixed) {}
+
+	~DecodeServer() {
+		pool.stop();
+		for (int i = 0; i < stream_count; ++i)
+			if (streams[i].fd >= 0)
+				release(i);
+		if (listener >= 0)
+			close(listener);
+		if (wake >= 0)
+			close(wake);
+		delete[] groups;
+	}
+
+	// streams added after this deliver interleaved I/Q at iq_rate, shifted by frequency
+	bool input(int format, int iq_rate, float frequency) {
+		if (groups)
+			return false;
+		IQInput probe;
+		if (!probe.setup(format, iq_rate, rate, frequency, extended_length))
+			return false;
+		iq_format = format;
+		this->iq_rate = iq_rate;
+		iq_frequency = frequency;
+		return true;
+	}
+
+	// with lanes, same rate PCM streams are decoded in groups of multi_lanes by one MultiDecoder each
+	bool start(int threads, bool lanes = false) {
+		if (lanes && !(groups = new(std::nothrow) LaneGroup[stream_count / multi_lanes]))
+			return false;
+		wake = eventfd(0, EFD_NONBLOCK);
+		if (wake < 0)
+			return false;
+		return pool.start(threads, [this](int id) { serve(id); });
+	}
+
+	// takes ownership of fd, returns the stream id or -1
+	int add(int fd) {
+		for (int id = 0; id < stream_count; ++id) {
+			ServerStream &stream = streams[id];
+			if (stream.fd >= 0 || (groups && busy(id)))
+				continue;
+			if (groups) {
+				LaneGroup &group = groups[id / multi_lanes];
+				if (!group.decoder)
+					group.decoder = create_multi_decoder(rate);
+				if (!group.audio)
+					group.audio = new(std::nothrow) int16_t[multi_lanes * extended_length];
+				if (!group.decoder || !group.audio)
+					break;
+				stream.decoder = group.decoder->lane(id % multi_lanes);
+			} else {
+				stream.decoder = create_decoder(rate, fixed);
+			}
+			stream.audio = new(std::nothrow) int16_t[extended_length];
+			if (iq_format >= 0) {
+				stream.iq = new(std::nothrow) IQInput();
+				if (stream.iq && !stream.iq->setup(iq_format, iq_rate, rate, iq_frequency, extended_length)) {
+					delete stream.iq;
+					stream.iq = nullptr;
+				}
+			}
+			if (!stream.decoder || !stream.audio || (iq_format >= 0 && !stream.iq) || fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK) < 0) {
+				if (!groups)
+					delete stream.decoder;
+				delete stream.iq;
+				delete[] stream.audio;
+				stream.decoder = nullptr;
+				stream.iq = nullptr;
+				stream.audio = nullptr;
+				break;
+			}
+			stream.decoder->reset();
+			stream.started = clock::now();
+			stream.samples = stream.nanos = 0;
+			stream.messages = 0;
+			stream.filled = 0;
+			stream.tail = 0;
+			stream.readable = false;
+			stream.fd = fd;
+			return id;
+		}
+		close(fd);
+		return -1;
+	}
+
+	bool listen(const char *path) {
+		struct sockaddr_un address = {};
+		if (std::strlen(path) >= sizeof(address.sun_path))
+			return false;
+		address.sun_family = AF_UNIX;
+		std::strcpy(address.sun_path, path);
+		listener = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK, 0);
+		if (listener < 0)
+			return false;
+		unlink(path);
+		return !bind(listener, reinterpret_cast<struct sockaddr *>(&address), sizeof(address))
+			&& !::listen(listener, 16);
+	}
+
+	// polls until all streams ended and no listener is open, prints statistics every interval seconds
+	void run(int interval) {
+		clock::time_point last = clock::now();
+		std::vector<struct pollfd> fds;
+		std::vector<int> ids;
+		while (true) {
+			fds.clear();
+			ids.clear();
+			fds.push_back({wake, POLLIN, 0});
+			if (listener >= 0)
+				fds.push_back({listener, POLLIN, 0});
+			bool active = false;
+			for (int id = 0; id < stream_count; ++id) {
+				ServerStream &stream = streams[id];
+				if (stream.fd < 0)
+					continue;
+				if (!busy(id) && stream.closed) {
+					release(id);
+					continue;
+				}
+				active = true;
+				if (busy(id))
+					continue;
+				if (groups && (stream.tail || stream.filled == int(sizeof(int16_t)) * extended_length))
+					continue;
+				fds.push_back({stream.fd, POLLIN, 0});
+				ids.push_back(id);
+			}
+			if (!active && listener < 0)
+				return;
+			for (int group = 0; groups && group < stream_count / multi_lanes; ++group) {
+				if (groups[group].busy || !ready(group))
+					continue;
+				groups[group].busy = true;
+				pool.push(group * multi_lanes);
+			}
+			if (poll(fds.data(), fds.size(), interval > 0 ? 1000 * interval : -1) < 0 && errno != EINTR)
+				return;
+			uint64_t count;
+			if (fds[0].revents & POLLIN && read(wake, &count, sizeof(count)) < 0)
+				return;
+			int offset = 1;
+			if (listener >= 0) {
+				if (fds[1].revents & POLLIN) {
+					int fd = accept(listener, nullptr, nullptr);
+					if (fd >= 0)
+						add(fd);
+				}
+				offset = 2;
+			}
+			for (size_t i = 0; i < ids.size(); ++i) {
+				if (!fds[offset + i].revents)
+					continue;
+				streams[ids[i]].readable = true;
+				if (busy(ids[i]))
+					continue;
+				busy(ids[i]) = true;
+				pool.push(ids[i]);
+			}
+			if (interval > 0 && clock::now() - last >= std::chrono::seconds(interval)) {
+				last = clock::now();
+				for (int id = 0; id < stream_count; ++id)
+					if (streams[id].fd >= 0 && !streams[id].closed)
+						statistics(id, streams[id]);
+			}
+		}
+	}
+};
+
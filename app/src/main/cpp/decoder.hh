@@ -7,18 +7,26 @@ Copyright 2022 Ahmet Inan <inan@aicodix.de>
 #pragma once
 
 #include <cmath>
+#include <cstring>
 #include <iostream>
+#include <new>
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <condition_variable>
 
 namespace DSP { using std::abs; using std::min; using std::cos; using std::sin; }
 
 #include "schmidl_cox.hh"
 #include "bip_buffer.hh"
+#include "timing.hh"
+#include "capture.hh"
 #include "theil_sen.hh"
 #include "xorshift.hh"
 #include "decibel.hh"
 #include "complex.hh"
-#include "hilbert.hh"
-#include "blockdc.hh"
+#include "front_end.hh"
 #include "filter.hh"
 #include "window.hh"
 #include "coeffs.hh"
@@ -32,6 +40,7 @@ namespace DSP { using std::abs; using std::min; using std::cos; using std::sin;
 #include "crc.hh"
 #include "osd.hh"
 #include "psk.hh"
+#include "simd.hh"
 
 #define STATUS_OKAY 0
 #define STATUS_FAIL 1
@@ -41,9 +50,46 @@ namespace DSP { using std::abs; using std::min; using std::cos; using std::sin;
 #define STATUS_NOPE 5
 #define STATUS_PING 6
 
+#define TIMING_FEED 0
+#define TIMING_FRONT 1
+#define TIMING_CORRELATOR 2
+#define TIMING_PREAMBLE 3
+#define TIMING_PREAMBLE_FFT 4
+#define TIMING_OSD 5
+#define TIMING_SYMBOL 6
+#define TIMING_COMPENSATE 7
+#define TIMING_DEMAP 8
+#define TIMING_SPECTRUM 9
+#define TIMING_FETCH 10
+#define TIMING_POLAR 11
+#define TIMING_HYPOTHESES 12
+#define TIMING_COUNT 13
+
+#define EVENT_SYNC 0
+#define EVENT_OSD_OKAY 1
+#define EVENT_OSD_FAIL 2
+#define EVENT_CRC_FAIL 3
+#define EVENT_NOPE 4
+#define EVENT_PING 5
+#define EVENT_FRAME 6
+#define EVENT_POLAR_OKAY 7
+#define EVENT_POLAR_FAIL 8
+#define EVENT_DROP 9
+#define EVENT_RECOVERED 10
+#define EVENT_COUNT 11
+
+#define QUALITY_SNR 0
+#define QUALITY_PHASE_SLOPE 1
+#define QUALITY_TIMING_OFFSET 2
+#define QUALITY_FLIPS 3
+#define QUALITY_PATH 4
+#define QUALITY_COUNT 5
+
 struct DecoderInterface {
 	virtual bool feed(const int16_t *, int, int) = 0;
 
+	virtual bool feed(const DSP::Complex<float> *, int) = 0;
+
 	virtual int process() = 0;
 
 	virtual void spectrum(uint32_t *, uint32_t *, int) = 0;
@@ -52,16 +98,33 @@ struct DecoderInterface {
 
 	virtual int fetch(uint8_t *) = 0;
 
+	virtual void timing(int64_t *, bool) = 0;
+
+	virtual void metrics(int32_t *, float *, float *, bool) = 0;
+
+	virtual bool capture(const char *, int) = 0;
+
+	virtual bool hypotheses(int) = 0;
+
+	virtual void reset() = 0;
+
 	virtual int rate() = 0;
 
 	virtual ~DecoderInterface() = default;
 };
 
-template<int RATE>
+template<int RATE, typename front_type = float>
 class Decoder : public DecoderInterface {
 	typedef DSP::Complex<float> cmplx;
 	typedef DSP::Const<float> Const;
 	typedef int8_t code_type;
+#ifdef __AVX2__
+	typedef SIMD<float, 8> float_simd;
+#else
+	typedef SIMD<float, 4> float_simd;
+#endif
+	typedef SIMD<uint32_t, float_simd::SIZE> uint32_simd;
+	typedef SIMD<int32_t, float_simd::SIZE> int32_simd;
 	static const int spectrum_width = 360, spectrum_height = 128;
 	static const int spectrogram_width = 360, spectrogram_height = 128;
 	static const int code_order = 11;
@@ -85,38 +148,118 @@ class Decoder : public DecoderInterface {
 	static const int pay_car_off = -pay_car_cnt / 2;
 	static const int buffer_length = 4 * extended_length;
 	static const int search_position = extended_length;
+	static const int capture_length = 16 * extended_length;
+	static const int frame_count = 4;
+	static const int candidate_count = 4;
+	static const int report_count = 16;
+	static const int hypothesis_count = 8;
+	static const int hypothesis_timing = guard_length / 4;
+	static constexpr float hypothesis_cfo = DSP::Const<float>::Pi() / symbol_length;
+	static constexpr int hypothesis_grid[hypothesis_count][2] = {
+		{0, -1}, {0, 1}, {-1, 0}, {1, 0}, {-1, -1}, {-1, 1}, {1, -1}, {1, 1}};
+	static constexpr const char *timing_names[TIMING_COUNT] = {
+		"feed", "front end", "correlator", "preamble", "preamble fft", "osd",
+		"symbol", "compensate", "demap", "spectrum", "fetch", "polar", "hypotheses"};
 	DSP::FastFourierTransform<symbol_length, cmplx, -1> fwd;
 	DSP::FastFourierTransform<stft_length, cmplx, -1> stft;
-	SchmidlCox<float, cmplx, search_position, symbol_length / 2, guard_length> correlator;
-	DSP::BlockDC<float, float> block_dc;
-	DSP::Hilbert<cmplx, filter_length> hilbert;
+	typedef SchmidlCox<float, cmplx, search_position, symbol_length / 2, guard_length> correlator_type;
+	struct Tables {
+		int8_t generator[255 * 71];
+		cmplx kernel[symbol_length / 2];
+		float window[window_length];
+
+		Tables() {
+			CODE::BoseChaudhuriHocquenghemGenerator<255, 71>::matrix(generator, true, {
+				0b100011101, 0b101110111, 0b111110011, 0b101101001,
+				0b110111101, 0b111100111, 0b100101011, 0b111010111,
+				0b000010011, 0b101100101, 0b110001011, 0b101100011,
+				0b100011011, 0b100111111, 0b110001101, 0b100101101,
+				0b101011111, 0b111111001, 0b111000011, 0b100111001,
+				0b110101001, 0b000011111, 0b110000111, 0b110110001});
+			cmplx seq[symbol_length / 2];
+			corSeq(seq);
+			correlator_type::kernel(kernel, seq);
+			DSP::Hann<float> hann;
+			DSP::LowPass2<float> lowpass(1, symbol_length);
+			DSP::Coeffs<window_length, float, true> coeffs(&hann, &lowpass);
+			for (int i = 0; i < window_length; ++i)
+				window[i] = coeffs[i];
+		}
+	};
+	struct Candidate {
+		float cfo_rad;
+		int position;
+		int offset;
+	};
+	struct Frame {
+		DSP::Phasor<cmplx> osc;
+		float prev_re[pay_car_cnt], prev_im[pay_car_cnt];
+		code_type code[code_len];
+		float signal_power[pay_car_cnt], error_power[pay_car_cnt];
+		float carrier_snr[pay_car_cnt], quality[QUALITY_COUNT];
+		float slope_sum, cfo_rad;
+		uint64_t call;
+		int64_t position;
+		int mode, offset, symbol_position;
+		int symbol_number = symbol_count;
+		bool done = false;
+	};
+	struct Report {
+		int status, frame, mode;
+		float cfo_rad;
+		uint64_t call;
+	};
+	struct Probe {
+		DSP::FastFourierTransform<symbol_length, cmplx, -1> fwd;
+		CODE::OrderedStatisticsDecoder<255, 71, 2> osd;
+		CODE::CRC<uint16_t> crc;
+		cmplx temp[symbol_length], freq[symbol_length];
+		int8_t soft[pre_seq_len];
+		uint8_t data[(pre_seq_len + 7) / 8];
+
+		Probe() : crc(0xA8F4) {}
+	};
+	const Tables &tables;
+	correlator_type correlator;
+	DSP::FrontEnd<front_type, filter_length> front_end;
 	DSP::BipBuffer<cmplx, buffer_length> buffer;
 	DSP::TheilSenEstimator<float, pay_car_cnt> tse;
-	DSP::Phasor<cmplx> osc;
-	DSP::Hann<float> hann;
-	DSP::LowPass2<float> lowpass;
-	DSP::Coeffs<window_length, float, true> window;
 	CODE::CRC<uint16_t> crc;
 	CODE::OrderedStatisticsDecoder<255, 71, 2> osd;
 	PolarDecoder<code_type> polar;
-	cmplx temp[extended_length], freq[symbol_length], prev[pay_car_cnt], cons[pay_car_cnt];
+	Timing<TIMING_COUNT> timer;
+	Capture<RATE, capture_length> *recorder = nullptr;
+	Probe *probes = nullptr;
+	std::thread *probe_workers = nullptr;
+	std::mutex probe_lock;
+	std::condition_variable probe_wake, probe_idle;
+	const Candidate *probe_candidate = nullptr;
+	std::atomic<int> probe_next{0}, probe_found{0};
+	uint64_t probe_results[hypothesis_count];
+	int probe_count = 0;
+	int probe_round = 0;
+	int probe_busy = 0;
+	bool probe_stop = false;
+	Frame frames[frame_count];
+	Candidate stored[candidate_count], staged_candidates[candidate_count];
+	Report reports[report_count];
+	Report current = {STATUS_OKAY, -1, 0, 0, 0};
+	cmplx temp[extended_length], freq[symbol_length];
+	float curr_re[pay_car_cnt], curr_im[pay_car_cnt], cons_re[pay_car_cnt], cons_im[pay_car_cnt];
 	float power[spectrum_width]{}, index[pay_car_cnt]{}, phase[pay_car_cnt]{};
-	code_type code[code_len];
-	int8_t generator[255 * 71];
+	float carrier_snr[pay_car_cnt]{};
+	float quality[QUALITY_COUNT]{};
+	int32_t events[EVENT_COUNT]{};
 	int8_t soft[pre_seq_len];
 	uint8_t data[(pre_seq_len + 7) / 8];
-	int symbol_number = symbol_count;
-	int symbol_position = search_position + extended_length;
-	int stored_position = 0;
-	int staged_position = 0;
-	int staged_mode = 0;
-	int operation_mode = 0;
+	int stored_count = 0;
+	int staged_count = 0;
+	int report_head = 0;
+	int report_size = 0;
 	int accumulated = 0;
-	float stored_cfo_rad = 0;
-	float staged_cfo_rad = 0;
-	uint64_t staged_call = 0;
-	bool stored_check = false;
-	bool staged_check = false;
+	int64_t input_count = 0;
+	int64_t buffer_end = 0;
+	bool block_ready = false;
 	const cmplx *buf;
 
 	static uint32_t argb(float a, float r, float g, float b) {
@@ -151,18 +294,6 @@ class Decoder : public DecoderInterface {
 		return 1 - 2 * bit;
 	}
 
-	static cmplx mod_map(code_type *b) {
-		return PhaseShiftKeying<4, cmplx, code_type>::map(b);
-	}
-
-	static void mod_hard(code_type *b, cmplx c) {
-		PhaseShiftKeying<4, cmplx, code_type>::hard(b, c);
-	}
-
-	static void mod_soft(code_type *b, cmplx c, float precision) {
-		PhaseShiftKeying<4, cmplx, code_type>::soft(b, c, precision);
-	}
-
 	static void base37(uint8_t *str, uint64_t val, int len) {
 		for (int i = len - 1; i >= 0; --i, val /= 37)
 			str[i] = " 0123456789ABCDEFGHIJKLMNOPQRSTUVWXYZ"[val % 37];
@@ -177,31 +308,37 @@ class Decoder : public DecoderInterface {
 		return cons;
 	}
 
-	const cmplx *corSeq() {
+	static void corSeq(cmplx *freq) {
 		CODE::MLS seq(cor_seq_poly);
 		for (int i = 0; i < symbol_length / 2; ++i)
 			freq[i] = 0;
 		for (int i = 0; i < cor_seq_len; ++i)
 			freq[(i + cor_seq_off / 2 + symbol_length / 2) % (symbol_length / 2)] = nrz(seq());
-		return freq;
 	}
 
-	cmplx analytic(float real) {
-		return hilbert(block_dc(real));
+	static const Tables &shared_tables() {
+		static const Tables shared;
+		return shared;
 	}
 
 	cmplx convert(const int16_t *samples, int channel, int i) {
 		switch (channel) {
 			case 1:
-				return analytic(samples[2 * i] / 32768.f);
+				return front_end(2 * samples[2 * i]);
 			case 2:
-				return analytic(samples[2 * i + 1] / 32768.f);
+				return front_end(2 * samples[2 * i + 1]);
 			case 3:
-				return analytic(((int) samples[2 * i] + (int) samples[2 * i + 1]) / 65536.f);
+				return front_end((int) samples[2 * i] + (int) samples[2 * i + 1]);
 			case 4:
 				return cmplx(samples[2 * i], samples[2 * i + 1]) / 32768.f;
 		}
-		return analytic(samples[i] / 32768.f);
+		return front_end(2 * samples[i]);
+	}
+
+	void front(const int16_t *audio_buffer, int sample_count, int channel_select) {
+		auto scope = timer(TIMING_FRONT);
+		for (int i = 0; i < sample_count; ++i)
+			temp[i] = convert(audio_buffer, channel_select, i);
 	}
 
 	void update_spectrum(uint32_t *pixels, uint32_t tint) {
@@ -221,55 +358,239 @@ class Decoder : public DecoderInterface {
 			pixels[i] = rainbow(power[i]);
 	}
 
-	void compensate() {
+	static float_simd erase(uint32_simd mask, float_simd a) {
+		return vreinterpret<float_simd>(vand(mask, vreinterpret<uint32_simd>(a)));
+	}
+
+	void differential(const Frame &frame) {
+		for (int i = 0; i < pay_car_cnt; i += float_simd::SIZE) {
+			float_simd cr, ci, pr, pi;
+			std::memcpy(&cr, curr_re + i, sizeof(cr));
+			std::memcpy(&ci, curr_im + i, sizeof(ci));
+			std::memcpy(&pr, frame.prev_re + i, sizeof(pr));
+			std::memcpy(&pi, frame.prev_im + i, sizeof(pi));
+			float_simd pp = vadd(vmul(pr, pr), vmul(pi, pi));
+			float_simd cc = vadd(vmul(cr, cr), vmul(ci, ci));
+			uint32_simd keep = vand(vcgtz(pp), vclez(vsub(cc, vmul(vdup<float_simd>(4), pp))));
+			float_simd re = erase(keep, vdiv(vadd(vmul(cr, pr), vmul(ci, pi)), pp));
+			float_simd im = erase(keep, vdiv(vsub(vmul(ci, pr), vmul(cr, pi)), pp));
+			std::memcpy(cons_re + i, &re, sizeof(re));
+			std::memcpy(cons_im + i, &im, sizeof(im));
+		}
+	}
+
+	float rotate(Frame &frame) {
+		float_simd lane, np = vzero<float_simd>();
+		for (int k = 0; k < float_simd::SIZE; ++k)
+			lane.v[k] = k + pay_car_off;
+		float_simd slope = vdup<float_simd>(-tse.slope()), yint = vdup<float_simd>(-tse.yint());
+		float_simd hard = vdup<float_simd>(PhaseShiftKeying<4, cmplx, code_type>::rcp_sqrt_2);
+		for (int i = 0; i < pay_car_cnt; i += float_simd::SIZE) {
+			float_simd rr, ri, cr, ci, sp, ep;
+			vsincos(&ri, &rr, vadd(vmul(vadd(lane, vdup<float_simd>(i)), slope), yint));
+			std::memcpy(&cr, cons_re + i, sizeof(cr));
+			std::memcpy(&ci, cons_im + i, sizeof(ci));
+			float_simd re = vsub(vmul(cr, rr), vmul(ci, ri));
+			float_simd im = vadd(vmul(cr, ri), vmul(ci, rr));
+			std::memcpy(cons_re + i, &re, sizeof(re));
+			std::memcpy(cons_im + i, &im, sizeof(im));
+			float_simd er = vsub(re, vcopysign(hard, re));
+			float_simd ei = vsub(im, vcopysign(hard, im));
+			float_simd err = vadd(vmul(er, er), vmul(ei, ei));
+			np = vadd(np, err);
+			std::memcpy(&ep, frame.error_power + i, sizeof(ep));
+			ep = vadd(ep, err);
+			std::memcpy(frame.error_power + i, &ep, sizeof(ep));
+			std::memcpy(&sp, frame.signal_power + i, sizeof(sp));
+			sp = vadd(sp, vdup<float_simd>(1));
+			std::memcpy(frame.signal_power + i, &sp, sizeof(sp));
+		}
+		float sum = 0;
+		for (int k = 0; k < float_simd::SIZE; ++k)
+			sum += np.v[k];
+		return pay_car_cnt / sum;
+	}
+
+	float compensate(Frame &frame) {
+		auto scope = timer(TIMING_COMPENSATE);
+		for (int i = 0; i < pay_car_cnt; i += float_simd::SIZE) {
+			float_simd re, im;
+			std::memcpy(&re, cons_re + i, sizeof(re));
+			std::memcpy(&im, cons_im + i, sizeof(im));
+			float_simd sr = vcopysign(vdup<float_simd>(1), re), si = vcopysign(vdup<float_simd>(1), im);
+			float_simd ph = vatan2(vsub(vmul(im, sr), vmul(re, si)), vadd(vmul(re, sr), vmul(im, si)));
+			std::memcpy(phase + i, &ph, sizeof(ph));
+		}
 		int count = 0;
 		for (int i = 0; i < pay_car_cnt; ++i) {
-			cmplx con = cons[i];
-			if (con.real() != 0 && con.imag() != 0) {
-				code_type tmp[mod_bits];
-				mod_hard(tmp, con);
+			if (cons_re[i] != 0 && cons_im[i] != 0) {
 				index[count] = i + pay_car_off;
-				phase[count] = arg(con * conj(mod_map(tmp)));
+				phase[count] = phase[i];
 				++count;
 			}
 		}
 		tse.compute(index, phase, count);
-		for (int i = 0; i < pay_car_cnt; ++i)
-			cons[i] *= DSP::polar<float>(1, -tse(i + pay_car_off));
+		frame.slope_sum += tse.slope();
+		return rotate(frame);
 	}
 
-	float precision() {
+	void demap(Frame &frame, float precision) {
+		auto scope = timer(TIMING_DEMAP);
+		code_type *code = frame.code + mod_bits * frame.symbol_number * pay_car_cnt;
+		float_simd scale = vdup<float_simd>(PhaseShiftKeying<4, cmplx, code_type>::DIST * precision);
+		for (int i = 0; i < pay_car_cnt; i += float_simd::SIZE) {
+			float_simd cr, ci;
+			std::memcpy(&cr, cons_re + i, sizeof(cr));
+			std::memcpy(&ci, cons_im + i, sizeof(ci));
+			int32_simd re = vcvtn(vclamp(vmul(cr, scale), -128, 127));
+			int32_simd im = vcvtn(vclamp(vmul(ci, scale), -128, 127));
+			for (int k = 0; k < float_simd::SIZE; ++k) {
+				code[mod_bits * (i + k)] = re.v[k];
+				code[mod_bits * (i + k) + 1] = im.v[k];
+			}
+		}
+	}
+
+	void record(int reason, int after, const Report &report, int64_t position) {
+		if (recorder)
+			recorder->trigger(reason, after, report.mode, report.cfo_rad * (RATE / Const::TwoPi()), report.call, position - input_count);
+	}
+
+	// kept with the frame until its report is drained, other frames may finish in the same block
+	void finish_metrics(Frame &frame) {
 		float sp = 0, np = 0;
 		for (int i = 0; i < pay_car_cnt; ++i) {
-			code_type tmp[mod_bits];
-			mod_hard(tmp, cons[i]);
-			cmplx hard = mod_map(tmp);
-			cmplx error = cons[i] - hard;
-			sp += norm(hard);
-			np += norm(error);
+			sp += frame.signal_power[i];
+			np += frame.error_power[i];
+			frame.carrier_snr[i] = frame.error_power[i] > 0 ? DSP::decibel(frame.signal_power[i] / frame.error_power[i]) : 0;
 		}
-		return sp / np;
+		frame.quality[QUALITY_SNR] = np > 0 ? DSP::decibel(sp / np) : 0;
+		frame.quality[QUALITY_PHASE_SLOPE] = frame.slope_sum / symbol_count;
+		frame.quality[QUALITY_TIMING_OFFSET] = frame.offset;
+		frame.quality[QUALITY_FLIPS] = -1;
+		frame.quality[QUALITY_PATH] = -1;
 	}
 
-	void demap() {
-		float pre = precision();
+	void expose(const Frame &frame) {
 		for (int i = 0; i < pay_car_cnt; ++i)
-			mod_soft(code + mod_bits * (symbol_number * pay_car_cnt + i), cons[i], pre);
+			carrier_snr[i] = frame.carrier_snr[i];
+		for (int i = 0; i < QUALITY_COUNT; ++i)
+			quality[i] = frame.quality[i];
+	}
+
+	void release(const Report &report) {
+		if (report.status == STATUS_DONE)
+			frames[report.frame].done = false;
 	}
 
-	int preamble() {
+	void report(const Report &report) {
+		if (report_size == report_count) {
+			release(reports[report_head]);
+			report_head = (report_head + 1) % report_count;
+			--report_size;
+			++events[EVENT_DROP];
+		}
+		reports[(report_head + report_size++) % report_count] = report;
+	}
+
+	bool duplicate(const Candidate &candidate) {
+		for (const Frame &frame: frames)
+			if (frame.symbol_number < symbol_count
+				&& std::abs(frame.symbol_position - candidate.position) < guard_length
+				&& std::abs(frame.cfo_rad - candidate.cfo_rad) < 4 * Const::TwoPi() / symbol_length)
+				return true;
+		return false;
+	}
+
+	int idle_frame() {
+		for (int i = 0; i < frame_count; ++i)
+			if (frames[i].symbol_number >= symbol_count && !frames[i].done)
+				return i;
+		return -1;
+	}
+
+	void sync(Candidate candidate) {
+		if (duplicate(candidate))
+			return;
+		Report result = {STATUS_OKAY, -1, 0, 0, 0};
+		result.status = preamble(candidate, result);
+		result.cfo_rad = candidate.cfo_rad;
+		int64_t position = buffer_end - buffer_length + candidate.position - (filter_length - 1) / 2;
+		if (result.status == STATUS_FAIL)
+			record(CAPTURE_FAIL, 2 * extended_length, result, position);
+		else if (result.status == STATUS_OKAY)
+			record(CAPTURE_SYNC, (symbol_count + 3) * extended_length, result, position);
+		else
+			record(CAPTURE_SYNC, 2 * extended_length, result, position);
+		if (result.status == STATUS_OKAY) {
+			result.frame = idle_frame();
+			if (result.frame < 0) {
+				++events[EVENT_DROP];
+				return;
+			}
+			Frame &frame = frames[result.frame];
+			frame.osc.omega(-candidate.cfo_rad);
+			frame.symbol_position = candidate.position;
+			frame.symbol_number = -1;
+			frame.mode = result.mode;
+			frame.call = result.call;
+			frame.cfo_rad = candidate.cfo_rad;
+			frame.offset = candidate.offset;
+			frame.position = position;
+			frame.slope_sum = 0;
+			for (int i = 0; i < pay_car_cnt; ++i)
+				frame.signal_power[i] = frame.error_power[i] = 0;
+			result.status = STATUS_SYNC;
+		}
+		report(result);
+	}
+
+	void demod(int number) {
+		auto scope = timer(TIMING_SYMBOL);
+		Frame &frame = frames[number];
+		for (int i = 0; i < extended_length; ++i)
+			temp[i] = buf[frame.symbol_position + i] * frame.osc();
+		fwd(freq, temp);
+		for (int i = 0; i < pay_car_cnt; ++i) {
+			curr_re[i] = freq[bin(i + pay_car_off)].real();
+			curr_im[i] = freq[bin(i + pay_car_off)].imag();
+		}
+		if (frame.symbol_number >= 0) {
+			differential(frame);
+			demap(frame, compensate(frame));
+		}
+		if (++frame.symbol_number == symbol_count) {
+			finish_metrics(frame);
+			frame.done = true;
+			report({STATUS_DONE, number, frame.mode, frame.cfo_rad, frame.call});
+		}
+		std::memcpy(frame.prev_re, curr_re, sizeof(curr_re));
+		std::memcpy(frame.prev_im, curr_im, sizeof(curr_im));
+	}
+
+	bool preamble_osd() {
+		auto scope = timer(TIMING_OSD);
+		return osd(data, soft, tables.generator);
+	}
+
+	void preamble_fft(const Candidate &candidate) {
+		auto scope = timer(TIMING_PREAMBLE_FFT);
 		DSP::Phasor<cmplx> nco;
-		nco.omega(-staged_cfo_rad);
+		nco.omega(-candidate.cfo_rad);
 		for (int i = 0; i < symbol_length; ++i)
-			temp[i] = buf[staged_position + i] * nco();
+			temp[i] = buf[candidate.position + i] * nco();
 		fwd(freq, temp);
+	}
+
+	static void preamble_soft(int8_t *soft, cmplx *freq) {
 		CODE::MLS seq(pre_seq_poly);
 		for (int i = 0; i < pre_seq_len; ++i)
 			freq[bin(i + pre_seq_off)] *= nrz(seq());
 		for (int i = 0; i < pre_seq_len; ++i)
 			PhaseShiftKeying<2, cmplx, int8_t>::soft(soft + i, demod_or_erase(freq[bin(i + pre_seq_off)], freq[bin(i - 1 + pre_seq_off)]), 32);
-		if (!osd(data, soft, generator))
-			return STATUS_FAIL;
+	}
+
+	static bool preamble_crc(uint64_t *meta_data, const uint8_t *data, CODE::CRC<uint16_t> &crc) {
 		uint64_t md = 0;
 		for (int i = 0; i < 55; ++i)
 			md |= (uint64_t) CODE::get_be_bit(data, i) << i;
@@ -277,48 +598,264 @@ class Decoder : public DecoderInterface {
 		for (int i = 0; i < 16; ++i)
 			cs |= (uint16_t) CODE::get_be_bit(data, i + 55) << i;
 		crc.reset();
-		if (crc(md << 9) != cs)
+		*meta_data = md;
+		return crc(md << 9) == cs;
+	}
+
+	bool probe(Probe &worker, int position, float cfo_rad, uint64_t *md) {
+		DSP::Phasor<cmplx> nco;
+		nco.omega(-cfo_rad);
+		for (int i = 0; i < symbol_length; ++i)
+			worker.temp[i] = buf[position + i] * nco();
+		worker.fwd(worker.freq, worker.temp);
+		preamble_soft(worker.soft, worker.freq);
+		return worker.osd(worker.data, worker.soft, tables.generator) && preamble_crc(md, worker.data, worker.crc);
+	}
+
+	void search(Probe &worker) {
+		for (int i = probe_next++; i < probe_found; i = probe_next++) {
+			int position = probe_candidate->position + hypothesis_timing * hypothesis_grid[i][0];
+			float cfo_rad = probe_candidate->cfo_rad + hypothesis_cfo * hypothesis_grid[i][1];
+			if (position < 0 || position + extended_length > buffer_length)
+				continue;
+			if (probe(worker, position, cfo_rad, probe_results + i)) {
+				int best = probe_found;
+				while (i < best && !probe_found.compare_exchange_weak(best, i));
+			}
+		}
+	}
+
+	// parked between near misses, each round searches the hypotheses with its own probe
+	void probe_worker(Probe *worker, int round) {
+		std::unique_lock<std::mutex> lock(probe_lock);
+		while (true) {
+			probe_wake.wait(lock, [&] { return probe_stop || probe_round != round; });
+			if (probe_stop)
+				return;
+			round = probe_round;
+			lock.unlock();
+			search(*worker);
+			lock.lock();
+			if (!--probe_busy)
+				probe_idle.notify_one();
+		}
+	}
+
+	void stop_probes() {
+		if (probe_workers) {
+			{
+				std::lock_guard<std::mutex> guard(probe_lock);
+				probe_stop = true;
+			}
+			probe_wake.notify_all();
+			for (int i = 0; i < probe_count - 1; ++i)
+				if (probe_workers[i].joinable())
+					probe_workers[i].join();
+			delete[] probe_workers;
+			probe_workers = nullptr;
+			probe_stop = false;
+		}
+		delete[] probes;
+		probes = nullptr;
+		probe_count = 0;
+	}
+
+	// on a near miss, retry the preamble around the estimated timing and cfo and take the first that passes the crc
+	bool recover(Candidate &candidate, uint64_t *md) {
+		if (!probe_count)
+			return false;
+		auto scope = timer(TIMING_HYPOTHESES);
+		{
+			std::lock_guard<std::mutex> guard(probe_lock);
+			probe_candidate = &candidate;
+			probe_next = 0;
+			probe_found = hypothesis_count;
+			probe_busy = probe_count - 1;
+			++probe_round;
+		}
+		probe_wake.notify_all();
+		search(probes[0]);
+		{
+			std::unique_lock<std::mutex> lock(probe_lock);
+			probe_idle.wait(lock, [&] { return !probe_busy; });
+		}
+		int i = probe_found;
+		if (i >= hypothesis_count)
+			return false;
+		candidate.position += hypothesis_timing * hypothesis_grid[i][0];
+		candidate.cfo_rad += hypothesis_cfo * hypothesis_grid[i][1];
+		*md = probe_results[i];
+		++events[EVENT_RECOVERED];
+		return true;
+	}
+
+	int preamble(Candidate &candidate, Report &result) {
+		auto scope = timer(TIMING_PREAMBLE);
+		preamble_fft(candidate);
+		preamble_soft(soft, freq);
+		uint64_t md = 0;
+		bool okay = preamble_osd();
+		++events[okay ? EVENT_OSD_OKAY : EVENT_OSD_FAIL];
+		if (okay && !(okay = preamble_crc(&md, data, crc)))
+			++events[EVENT_CRC_FAIL];
+		if (!okay && !recover(candidate, &md))
 			return STATUS_FAIL;
-		staged_mode = md & 255;
-		staged_call = md >> 8;
-		if (staged_mode && (staged_mode < 14 || staged_mode > 16))
+		result.mode = md & 255;
+		result.call = md >> 8;
+		if (result.mode && (result.mode < 14 || result.mode > 16)) {
+			++events[EVENT_NOPE];
 			return STATUS_NOPE;
-		if (staged_call == 0 || staged_call >= 129961739795077L) {
-			staged_call = 0;
+		}
+		if (result.call == 0 || result.call >= 129961739795077L) {
+			result.call = 0;
+			++events[EVENT_NOPE];
 			return STATUS_NOPE;
 		}
-		if (!staged_mode)
+		if (!result.mode) {
+			++events[EVENT_PING];
 			return STATUS_PING;
+		}
+		++events[EVENT_FRAME];
 		return STATUS_OKAY;
 	}
 
+	void found() {
+		if (stored_count < candidate_count)
+			stored[stored_count++] = {correlator.cfo_rad, correlator.symbol_pos + accumulated, correlator.pos_err};
+		else
+			++events[EVENT_DROP];
+		++events[EVENT_SYNC];
+#ifdef ENABLE_TRACING
+		Trace::instant("sync");
+#endif
+	}
+
+	void advance(int i) {
+		if (++accumulated == extended_length) {
+			buf = buffer();
+			buffer_end = input_count + i + 1;
+		}
+	}
+
+	bool block(int sample_count) {
+		input_count += sample_count;
+		if (accumulated >= extended_length) {
+			accumulated -= extended_length;
+			for (int i = 0; i < stored_count; ++i)
+				staged_candidates[i] = stored[i];
+			staged_count = stored_count;
+			stored_count = 0;
+			block_ready = true;
+			return true;
+		}
+		return false;
+	}
+
 public:
-	Decoder() : correlator(corSeq()), crc(0xA8F4), lowpass(1, symbol_length), window(&hann, &lowpass) {
-		CODE::BoseChaudhuriHocquenghemGenerator<255, 71>::matrix(generator, true, {
-			0b100011101, 0b101110111, 0b111110011, 0b101101001,
-			0b110111101, 0b111100111, 0b100101011, 0b111010111,
-			0b000010011, 0b101100101, 0b110001011, 0b101100011,
-			0b100011011, 0b100111111, 0b110001101, 0b100101101,
-			0b101011111, 0b111111001, 0b111000011, 0b100111001,
-			0b110101001, 0b000011111, 0b110000111, 0b110110001});
-		block_dc.samples(filter_length);
-		osc.omega(-2000, RATE);
+	Decoder() : tables(shared_tables()), correlator(tables.kernel), crc(0xA8F4), timer(timing_names) {}
+
+	~Decoder() {
+		delete recorder;
+		stop_probes();
 	}
 
 	int rate() final {
 		return RATE;
 	}
 
+	void reset() final {
+		correlator.reset();
+		front_end.reset();
+		buffer.reset();
+		timer.reset();
+		if (recorder)
+			recorder->reset();
+		for (Frame &frame: frames) {
+			frame.symbol_number = symbol_count;
+			frame.done = false;
+		}
+		current = {STATUS_OKAY, -1, 0, 0, 0};
+		for (int i = 0; i < pay_car_cnt; ++i)
+			carrier_snr[i] = 0;
+		for (int i = 0; i < QUALITY_COUNT; ++i)
+			quality[i] = 0;
+		for (int i = 0; i < EVENT_COUNT; ++i)
+			events[i] = 0;
+		stored_count = staged_count = 0;
+		report_head = report_size = 0;
+		accumulated = 0;
+		input_count = buffer_end = 0;
+		block_ready = false;
+	}
+
+	bool capture(const char *directory, int triggers) final {
+		if (!directory || !triggers) {
+			delete recorder;
+			recorder = nullptr;
+			return true;
+		}
+		if (!recorder)
+			recorder = new(std::nothrow) Capture<RATE, capture_length>();
+		return recorder && recorder->open(directory, triggers);
+	}
+
+	// the calling thread searches too, so threads - 1 workers are kept parked until the next near miss
+	bool hypotheses(int threads) final {
+		threads = std::min(std::max(threads, 0), hypothesis_count);
+		if (threads == probe_count)
+			return true;
+		stop_probes();
+		if (!threads)
+			return true;
+		probes = new(std::nothrow) Probe[threads];
+		if (!probes)
+			return false;
+		if (threads > 1) {
+			probe_workers = new(std::nothrow) std::thread[threads - 1];
+			if (!probe_workers) {
+				delete[] probes;
+				probes = nullptr;
+				return false;
+			}
+		}
+		probe_count = threads;
+		for (int i = 1; i < threads; ++i)
+			probe_workers[i - 1] = std::thread(&Decoder::probe_worker, this, probes + i, probe_round);
+		return true;
+	}
+
 	void staged(float *cfo, int32_t *mode, uint8_t *call) final {
-		*cfo = staged_cfo_rad * (RATE / Const::TwoPi());
-		*mode = staged_mode;
-		base37(call, staged_call, 9);
+		*cfo = current.cfo_rad * (RATE / Const::TwoPi());
+		*mode = current.mode;
+		base37(call, current.call, 9);
+	}
+
+	void timing(int64_t *stats, bool reset) final {
+		timer.read(stats);
+		if (reset)
+			timer.reset();
+	}
+
+	void metrics(int32_t *event_counts, float *frame_quality, float *carrier_snr, bool reset) final {
+		for (int i = 0; i < EVENT_COUNT; ++i)
+			event_counts[i] = events[i];
+		for (int i = 0; i < QUALITY_COUNT; ++i)
+			frame_quality[i] = quality[i];
+		for (int i = 0; i < pay_car_cnt; ++i)
+			carrier_snr[i] = this->carrier_snr[i];
+		if (reset)
+			for (int i = 0; i < EVENT_COUNT; ++i)
+				events[i] = 0;
 	}
 
 	int fetch(uint8_t *payload) final {
+		auto scope = timer(TIMING_FETCH);
+		if (current.status != STATUS_DONE)
+			return -1;
+		Frame &frame = frames[current.frame];
 		const uint32_t *frozen_bits;
 		int data_bits;
-		switch (operation_mode) {
+		switch (frame.mode) {
 			case 14:
 				data_bits = 1360;
 				frozen_bits = frozen_2048_1392;
@@ -334,7 +871,16 @@ public:
 			default:
 				return -1;
 		}
-		int result = polar(payload, code, frozen_bits, data_bits);
+		int result;
+		{
+			auto scope = timer(TIMING_POLAR);
+			result = polar(payload, frame.code, frozen_bits, data_bits);
+		}
+		++events[result < 0 ? EVENT_POLAR_FAIL : EVENT_POLAR_OKAY];
+		if (result < 0)
+			record(CAPTURE_POLAR, 0, current, frame.position);
+		quality[QUALITY_FLIPS] = frame.quality[QUALITY_FLIPS] = result;
+		quality[QUALITY_PATH] = frame.quality[QUALITY_PATH] = polar.path;
 		CODE::Xorshift32 scrambler;
 		for (int i = 0; i < data_bits / 8; ++i)
 			payload[i] ^= scrambler();
@@ -344,71 +890,112 @@ public:
 	}
 
 	bool feed(const int16_t *audio_buffer, int sample_count, int channel_select) final {
+		auto scope = timer(TIMING_FEED);
 		assert(sample_count <= extended_length);
+		front(audio_buffer, sample_count, channel_select);
+		if (recorder)
+			(*recorder)(audio_buffer, sample_count, channel_select);
+		auto correlate = timer(TIMING_CORRELATOR);
 		for (int i = 0; i < sample_count; ++i) {
-			if (correlator(buffer(convert(audio_buffer, channel_select, i)))) {
-				stored_cfo_rad = correlator.cfo_rad;
-				stored_position = correlator.symbol_pos + accumulated;
-				stored_check = true;
-			}
-			if (++accumulated == extended_length)
-				buf = buffer();
+			if (correlator(buffer(temp[i])))
+				found();
+			advance(i);
 		}
-		if (accumulated >= extended_length) {
-			accumulated -= extended_length;
-			if (stored_check) {
-				staged_cfo_rad = stored_cfo_rad;
-				staged_position = stored_position;
-				staged_check = true;
-				stored_check = false;
-			}
-			return true;
+		return block(sample_count);
+	}
+
+	// analytic samples at RATE, e.g. from an I/Q front end
+	bool feed(const cmplx *samples, int sample_count) final {
+		auto scope = timer(TIMING_FEED);
+		assert(sample_count <= extended_length);
+		auto correlate = timer(TIMING_CORRELATOR);
+		for (int i = 0; i < sample_count; ++i) {
+			if (correlator(buffer(samples[i])))
+				found();
+			advance(i);
 		}
-		return false;
+		return block(sample_count);
 	}
 
+	// analytic samples with peaks from a SchmidlCoxLanes running outside
+	bool feed(const cmplx *samples, int sample_count, const SyncPeak *peaks, int peak_count) {
+		auto scope = timer(TIMING_FEED);
+		assert(sample_count <= extended_length);
+		auto correlate = timer(TIMING_CORRELATOR);
+		for (int i = 0, j = 0; i < sample_count; ++i) {
+			const cmplx *recent = buffer(samples[i]);
+			for (; j < peak_count && peaks[j].sample == i; ++j)
+				if (correlator.refine(recent, peaks[j].phase, peaks[j].index))
+					found();
+			advance(i);
+		}
+		return block(sample_count);
+	}
+
+	// returns one report per call, call again until STATUS_OKAY to drain them
 	int process() final {
-		int status = STATUS_OKAY;
-		if (staged_check) {
-			staged_check = false;
-			status = preamble();
-			if (status == STATUS_OKAY) {
-				operation_mode = staged_mode;
-				osc.omega(-staged_cfo_rad);
-				symbol_position = staged_position;
-				symbol_number = -1;
-				status = STATUS_SYNC;
-			}
+		if (block_ready) {
+			block_ready = false;
+			for (int i = 0; i < staged_count; ++i)
+				sync(staged_candidates[i]);
+			staged_count = 0;
+			for (int i = 0; i < frame_count; ++i)
+				if (frames[i].symbol_number < symbol_count)
+					demod(i);
 		}
-		if (symbol_number < symbol_count) {
-			for (int i = 0; i < extended_length; ++i)
-				temp[i] = buf[symbol_position + i] * osc();
-			fwd(freq, temp);
-			if (symbol_number >= 0) {
-				for (int i = 0; i < pay_car_cnt; ++i)
-					cons[i] = demod_or_erase(freq[bin(i + pay_car_off)], prev[i]);
-				compensate();
-				demap();
-			}
-			if (++symbol_number == symbol_count)
-				status = STATUS_DONE;
-			for (int i = 0; i < pay_car_cnt; ++i)
-				prev[i] = freq[bin(i + pay_car_off)];
+		release(current);
+		current = {STATUS_OKAY, -1, 0, 0, 0};
+		if (report_size) {
+			current = reports[report_head];
+			report_head = (report_head + 1) % report_count;
+			--report_size;
+			if (current.status == STATUS_DONE)
+				expose(frames[current.frame]);
 		}
-		return status;
+		return current.status;
 	}
 
 	void spectrum(uint32_t *spectrum_pixels, uint32_t *spectrogram_pixels, int spectrum_tint) final {
+		auto scope = timer(TIMING_SPECTRUM);
 		for (int j = 0; j < 2; ++j) {
 			for (int i = 0; i < stft_length; ++i)
 				temp[i] = 0;
 			for (int i = 0; i < window_length; ++i)
-				temp[i % stft_length] += window[i] * buf[buffer_length - window_length + stft_length * (j - 1) + i];
+				temp[i % stft_length] += tables.window[i] * buf[buffer_length - window_length + stft_length * (j - 1) + i];
 			stft(freq, temp);
 			for (int i = 0; i < spectrum_width; ++i)
-				power[i] = std::clamp<float>((DSP::decibel(norm(freq[i])) - dB_min) / (dB_max - dB_min), 0, 1);
+				power[i] = norm(freq[i]);
+			for (int i = 0; i < spectrum_width; i += float_simd::SIZE) {
+				float_simd p;
+				std::memcpy(&p, power + i, sizeof(p));
+				p = vmul(vlog10(p), vdup<float_simd>(10.f / (dB_max - dB_min)));
+				p = vclamp(vsub(p, vdup<float_simd>(float(dB_min) / (dB_max - dB_min))), 0, 1);
+				std::memcpy(power + i, &p, sizeof(p));
+			}
 			update_spectrogram(spectrogram_pixels);
 		}
 		update_spectrum(spectrum_pixels, spectrum_tint);
 	}
 };
+
+template<typename front_type>
+static DecoderInterface *create_decoder(int rate) {
+	switch (rate) {
+		case 8000:
+			return new(std::nothrow) Decoder<8000, front_type>();
+		case 16000:
+			return new(std::nothrow) Decoder<16000, front_type>();
+		case 32000:
+			return new(std::nothrow) Decoder<32000, front_type>();
+		case 44100:
+			return new(std::nothrow) Decoder<44100, front_type>();
+		case 48000:
+			return new(std::nothrow) Decoder<48000, front_type>();
+	}
+	return nullptr;
+}
+
+// the fixed point front end turns the real audio into the analytic signal with 32 bit integer arithmetic
+static DecoderInterface *create_decoder(int rate, bool fixed = false) {
+	return fixed ? create_decoder<int16_t>(rate) : create_decoder<float>(rate);
+}
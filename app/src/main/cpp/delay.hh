@@ -15,9 +15,14 @@ class Delay
 	int pos;
 public:
 	Delay(TYPE init = 0) : pos(0)
+	{
+		reset(init);
+	}
+	void reset(TYPE init = 0)
 	{
 		for (int i = 0; i < NUM; ++i)
 			buf[i] = init;
+		pos = 0;
 	}
 	TYPE operator () (TYPE input)
 	{
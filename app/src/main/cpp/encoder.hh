@@ -7,6 +7,9 @@ Copyright 2022 Ahmet Inan <inan@aicodix.de>
 #pragma once
 
 #include <cmath>
+#include <chrono>
+#include <new>
+#include <cstring>
 #include <iostream>
 #include "bose_chaudhuri_hocquenghem_encoder.hh"
 #include "base37_bitmap.hh"
@@ -17,18 +20,37 @@ Copyright 2022 Ahmet Inan <inan@aicodix.de>
 #include "utils.hh"
 #include "const.hh"
 #include "papr.hh"
+#include "simd.hh"
 #include "fft.hh"
 #include "mls.hh"
 #include "crc.hh"
 #include "psk.hh"
 
 struct EncoderInterface {
-	virtual void configure(const uint8_t *, const int8_t *, int, int, bool) = 0;
+	static int channels(int channel) {
+		switch (channel) {
+			case 1:
+			case 2:
+			case 4:
+				return 2;
+		}
+		return 1;
+	}
+
+	virtual void configure(const uint8_t *, const int8_t *, int, int, bool, int) = 0;
 
 	virtual bool produce(int16_t *, int) = 0;
 
+	virtual int length() = 0;
+
+	virtual int render(int16_t *, int) = 0;
+
+	virtual void papr(float *, int64_t *) = 0;
+
 	virtual int rate() = 0;
 
+	virtual void reset() = 0;
+
 	virtual ~EncoderInterface() = default;
 };
 
@@ -37,6 +59,11 @@ class Encoder : public EncoderInterface {
 	typedef DSP::Complex<float> cmplx;
 	typedef DSP::Const<float> Const;
 	typedef int8_t code_type;
+#ifdef __AVX2__
+	typedef SIMD<float, 8> float_simd;
+#else
+	typedef SIMD<float, 4> float_simd;
+#endif
 	static const int code_order = 11;
 	static const int mod_bits = 2;
 	static const int code_len = 1 << code_order;
@@ -55,15 +82,38 @@ class Encoder : public EncoderInterface {
 	static const int pay_car_off = -pay_car_cnt / 2;
 	static const int fancy_off = -(8 * 9 * 3) / 2;
 	static const int noise_poly = 0b100101010001;
+	static const int fancy_lines = 11;
+	// four seconds of leading noise at most, the symbol count is the same at every rate
+	static const int cached_noise = (4 * 8000) / (1280 * 9 / 8);
+	static const int cache_count = 1 + cached_noise + fancy_lines;
 	DSP::FastFourierTransform<symbol_length, cmplx, 1> bwd;
+	DSP::HalfComplexToRealTransform<symbol_length, cmplx> hc2r;
 	CODE::CRC<uint16_t> crc;
 	CODE::BoseChaudhuriHocquenghemEncoder<255, 71> bch;
 	CODE::MLS noise_seq;
 	ImprovePAPR<cmplx, symbol_length, (32000 + RATE / 2) / RATE> improve_papr;
-	PolarEncoder<code_type> polar;
-	cmplx temp[extended_length], freq[symbol_length], prev[pay_car_cnt], guard[guard_length];
+	PolarEncoder polar;
+	cmplx temp[extended_length], freq[symbol_length], prev[pay_car_cnt], guard[guard_length], fade[guard_length];
+	struct Window {
+		float w[2][guard_length];
+
+		Window() {
+			for (int i = 0; i < guard_length; ++i) {
+				float x = i / float(guard_length - 1);
+				float ratio(0.5);
+				w[0][i] = 0.5f * (1 - std::cos(Const::Pi() * x));
+				x = std::min(x, ratio) / ratio;
+				w[1][i] = 0.5f * (1 - std::cos(Const::Pi() * x));
+			}
+		}
+	};
+	const Window &window;
+	float real[symbol_length], stage[2 * extended_length];
+	float *cache = nullptr;
+	float cache_papr[cache_count];
+	bool cached[cache_count] = {false};
 	uint8_t mesg[max_bits / 8], call[9];
-	code_type code[code_len];
+	uint64_t code[code_len / 64];
 	uint64_t meta_data;
 	int operation_mode = 0;
 	int carrier_offset = 0;
@@ -71,6 +121,18 @@ class Encoder : public EncoderInterface {
 	int count_down = 0;
 	int fancy_line = 0;
 	int noise_count = 0;
+	int noise_total = 0;
+	int cache_offset = 0;
+	int cache_noise = 0;
+	int cache_iterations = 1;
+	int cache_width = 0;
+	int papr_iterations = 1;
+	float papr_last = 0;
+	float papr_peak = 0;
+	int64_t papr_nanos = 0;
+	uint64_t cache_call = 0;
+	bool cache_real = true;
+	bool real_output = true;
 
 	static uint8_t base37_map(int8_t c) {
 		if (c >= '0' && c <= '9')
@@ -89,11 +151,19 @@ class Encoder : public EncoderInterface {
 		return acc;
 	}
 
+	static const Window &shared_window() {
+		static const Window shared;
+		return shared;
+	}
+
 	static int nrz(bool bit) {
 		return 1 - 2 * bit;
 	}
 
-	static cmplx mod_map(code_type *b) {
+	static cmplx mod_map(const uint64_t *bits, int idx) {
+		code_type b[mod_bits];
+		for (int i = 0; i < mod_bits; ++i)
+			b[i] = nrz((bits[(idx + i) / 64] >> ((idx + i) % 64)) & 1);
 		return PhaseShiftKeying<4, cmplx, code_type>::map(b);
 	}
 
@@ -101,7 +171,46 @@ class Encoder : public EncoderInterface {
 		return (carrier + carrier_offset + symbol_length) % symbol_length;
 	}
 
+	// real output only needs the real part, analytic output the whole symbol
+	bool fetch_symbol(int index) {
+		if (!cached[index])
+			return false;
+		const float *symbol = cache + index * cache_width * symbol_length;
+		if (real_output) {
+			for (int i = 0; i < symbol_length; ++i)
+				temp[i] = symbol[i];
+		} else {
+			std::memcpy(reinterpret_cast<float *>(temp), symbol, sizeof(cmplx) * symbol_length);
+		}
+		papr_peak = std::max(papr_peak, cache_papr[index]);
+		return true;
+	}
+
+	void store_symbol(int index) {
+		int width = real_output ? 1 : 2;
+		if (cache_width != width) {
+			delete[] cache;
+			cache = new(std::nothrow) float[cache_count * width * symbol_length];
+			cache_width = cache ? width : 0;
+			for (int i = 0; i < cache_count; ++i)
+				cached[i] = false;
+		}
+		if (!cache)
+			return;
+		float *symbol = cache + index * width * symbol_length;
+		if (real_output) {
+			for (int i = 0; i < symbol_length; ++i)
+				symbol[i] = temp[i].real();
+		} else {
+			std::memcpy(symbol, reinterpret_cast<const float *>(temp), sizeof(cmplx) * symbol_length);
+		}
+		cache_papr[index] = papr_last;
+		cached[index] = true;
+	}
+
 	void schmidl_cox() {
+		if (fetch_symbol(0))
+			return;
 		CODE::MLS seq(cor_seq_poly);
 		float factor = std::sqrt(float(2 * symbol_length) / cor_seq_len);
 		for (int i = 0; i < symbol_length; ++i)
@@ -112,6 +221,7 @@ class Encoder : public EncoderInterface {
 		for (int i = 0; i < cor_seq_len; ++i)
 			freq[bin(2 * i + cor_seq_off)] *= freq[bin(2 * (i - 1) + cor_seq_off)];
 		transform();
+		store_symbol(0);
 	}
 
 	void preamble() {
@@ -142,10 +252,16 @@ class Encoder : public EncoderInterface {
 	}
 
 	void fancy_symbol() {
+		int index = 1 + cached_noise + fancy_line;
 		int active_carriers = 1;
 		for (int j = 0; j < 9; ++j)
 			for (int i = 0; i < 8; ++i)
 				active_carriers += (base37_bitmap[call[j] + 37 * fancy_line] >> i) & 1;
+		if (fetch_symbol(index)) {
+			for (int i = 1; i < active_carriers; ++i)
+				noise_seq();
+			return;
+		}
 		float factor = std::sqrt(float(symbol_length) / active_carriers);
 		for (int i = 0; i < symbol_length; ++i)
 			freq[i] = 0;
@@ -154,22 +270,31 @@ class Encoder : public EncoderInterface {
 				if (base37_bitmap[call[j] + 37 * fancy_line] & (1 << (7 - i)))
 					freq[bin((8 * j + i) * 3 + fancy_off)] = factor * nrz(noise_seq());
 		transform();
+		store_symbol(index);
 	}
 
 	void noise_symbol() {
+		int number = noise_total - noise_count - 1;
+		if (number < cached_noise && fetch_symbol(1 + number)) {
+			for (int i = 0; i < 2 * pay_car_cnt; ++i)
+				noise_seq();
+			return;
+		}
 		float factor = std::sqrt(symbol_length / float(pay_car_cnt));
 		for (int i = 0; i < symbol_length; ++i)
 			freq[i] = 0;
 		for (int i = 0; i < pay_car_cnt; ++i)
 			freq[bin(i + pay_car_off)] = factor * cmplx(nrz(noise_seq()), nrz(noise_seq()));
 		transform();
+		if (number < cached_noise)
+			store_symbol(1 + number);
 	}
 
 	void payload_symbol() {
 		for (int i = 0; i < symbol_length; ++i)
 			freq[i] = 0;
 		for (int i = 0; i < pay_car_cnt; ++i)
-			freq[bin(i + pay_car_off)] = prev[i] *= mod_map(code + mod_bits * (pay_car_cnt * symbol_number + i));
+			freq[bin(i + pay_car_off)] = prev[i] *= mod_map(code, mod_bits * (pay_car_cnt * symbol_number + i));
 		transform();
 	}
 
@@ -179,28 +304,63 @@ class Encoder : public EncoderInterface {
 	}
 
 	void transform() {
-		improve_papr(freq);
-		bwd(temp, freq);
-		for (int i = 0; i < symbol_length; ++i)
-			temp[i] /= std::sqrt(float(8 * symbol_length));
+		auto start = std::chrono::steady_clock::now();
+		papr_last = improve_papr(freq, papr_iterations);
+		papr_nanos += std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+		papr_peak = std::max(papr_peak, papr_last);
+		float factor = 1 / std::sqrt(float(8 * symbol_length));
+		if (real_output) {
+			for (int i = 0; i <= symbol_length / 2; ++i)
+				freq[i] = 0.5f * (freq[i] + conj(freq[(symbol_length - i) % symbol_length]));
+			hc2r(real, freq);
+			for (int i = 0; i < symbol_length; ++i)
+				temp[i] = factor * real[i];
+		} else {
+			bwd(temp, freq);
+			for (int i = 0; i < symbol_length; ++i)
+				temp[i] *= factor;
+		}
+	}
+
+	static void convert(int16_t *samples, const float *signal, int count) {
+		const int width = 2 * float_simd::SIZE;
+		int i = 0;
+		for (; i + width <= count; i += width) {
+			float_simd a, b;
+			std::memcpy(&a, signal + i, sizeof(a));
+			std::memcpy(&b, signal + i + float_simd::SIZE, sizeof(b));
+			a = vclamp(vmul(a, vdup<float_simd>(32767)), -32768, 32767);
+			b = vclamp(vmul(b, vdup<float_simd>(32767)), -32768, 32767);
+			auto c = vqmovn(vcvtn(a), vcvtn(b));
+			std::memcpy(samples + i, &c, sizeof(c));
+		}
+		for (; i < count; ++i)
+			samples[i] = std::clamp<float>(std::nearbyint(32767 * signal[i]), -32768, 32767);
 	}
 
-	void next_sample(int16_t *samples, cmplx signal, int channel, int i) {
+	void write(int16_t *samples, const cmplx *signal, int count, int channel) {
 		switch (channel) {
 			case 1:
-				samples[2 * i] = std::clamp<float>(std::nearbyint(32767 * signal.real()), -32768, 32767);
-				samples[2 * i + 1] = 0;
+				for (int i = 0; i < count; ++i) {
+					stage[2 * i] = signal[i].real();
+					stage[2 * i + 1] = 0;
+				}
+				convert(samples, stage, 2 * count);
 				break;
 			case 2:
-				samples[2 * i] = 0;
-				samples[2 * i + 1] = std::clamp<float>(std::nearbyint(32767 * signal.real()), -32768, 32767);
+				for (int i = 0; i < count; ++i) {
+					stage[2 * i] = 0;
+					stage[2 * i + 1] = signal[i].real();
+				}
+				convert(samples, stage, 2 * count);
 				break;
 			case 4:
-				samples[2 * i] = std::clamp<float>(std::nearbyint(32767 * signal.real()), -32768, 32767);
-				samples[2 * i + 1] = std::clamp<float>(std::nearbyint(32767 * signal.imag()), -32768, 32767);
+				convert(samples, reinterpret_cast<const float *>(signal), 2 * count);
 				break;
 			default:
-				samples[i] = std::clamp<float>(std::nearbyint(32767 * signal.real()), -32768, 32767);
+				for (int i = 0; i < count; ++i)
+					stage[i] = signal[i].real();
+				convert(samples, stage, count);
 		}
 	}
 
@@ -211,14 +371,47 @@ public:
 		0b000010011, 0b101100101, 0b110001011, 0b101100011,
 		0b100011011, 0b100111111, 0b110001101, 0b100101101,
 		0b101011111, 0b111111001, 0b111000011, 0b100111001,
-		0b110101001, 0b000011111, 0b110000111, 0b110110001}) {}
+		0b110101001, 0b000011111, 0b110000111, 0b110110001}), window(shared_window()) {
+	}
+
+	~Encoder() {
+		delete[] cache;
+	}
 
 	int rate() final {
 		return RATE;
 	}
 
+	// highest PAPR seen by the last clipping pass of any symbol since configure and the time spent reducing it
+	void papr(float *ratio, int64_t *nanoseconds) final {
+		*ratio = papr_peak;
+		*nanoseconds = papr_nanos;
+	}
+
+	// the symbol cache only depends on the configuration and stays warm
+	void reset() final {
+		operation_mode = 0;
+		carrier_offset = 0;
+		symbol_number = symbol_count;
+		count_down = 0;
+		fancy_line = 0;
+		noise_count = 0;
+		noise_total = 0;
+		noise_seq.reset();
+		papr_peak = 0;
+		papr_nanos = 0;
+		for (int i = 0; i < guard_length; ++i)
+			guard[i] = 0;
+	}
+
 	bool produce(int16_t *audio_buffer, int channel_select) final {
 		bool data_symbol = false;
+		real_output = channel_select != 4;
+		if (cache_real != real_output) {
+			cache_real = real_output;
+			for (int i = 0; i < cache_count; ++i)
+				cached[i] = false;
+		}
 		switch (count_down) {
 			case 5:
 				if (noise_count) {
@@ -255,27 +448,46 @@ public:
 				--count_down;
 				break;
 			default:
-				for (int i = 0; i < extended_length; ++i)
-					next_sample(audio_buffer, 0, channel_select, i);
+				for (int i = 0; i < channels(channel_select) * extended_length; ++i)
+					audio_buffer[i] = 0;
 				return false;
 		}
-		for (int i = 0; i < guard_length; ++i) {
-			float x = i / float(guard_length - 1);
-			float ratio(0.5);
-			if (data_symbol)
-				x = std::min(x, ratio) / ratio;
-			float y = 0.5f * (1 - std::cos(DSP::Const<float>::Pi() * x));
-			cmplx sum = DSP::lerp(guard[i], temp[i + symbol_length - guard_length], y);
-			next_sample(audio_buffer, sum, channel_select, i);
-		}
+		const float *weight = window.w[data_symbol];
+		for (int i = 0; i < guard_length; ++i)
+			fade[i] = DSP::lerp(guard[i], temp[i + symbol_length - guard_length], weight[i]);
 		for (int i = 0; i < guard_length; ++i)
 			guard[i] = temp[i];
-		for (int i = 0; i < symbol_length; ++i)
-			next_sample(audio_buffer, temp[i], channel_select, i + guard_length);
+		write(audio_buffer, fade, guard_length, channel_select);
+		write(audio_buffer + channels(channel_select) * guard_length, temp, symbol_length, channel_select);
 		return true;
 	}
 
-	void configure(const uint8_t *payload, const int8_t *call_sign, int carrier_frequency, int noise_symbols, bool fancy_header) final {
+	int length() final {
+		int symbols = 0;
+		if (count_down >= 5)
+			symbols += noise_count;
+		if (count_down >= 4)
+			++symbols;
+		if (count_down >= 3)
+			++symbols;
+		if (count_down >= 2 && operation_mode)
+			symbols += symbol_count - symbol_number;
+		if (count_down >= 1)
+			symbols += fancy_line + 1;
+		return symbols * extended_length;
+	}
+
+	int render(int16_t *audio_buffer, int channel_select) final {
+		int count = 0;
+		while (count_down) {
+			produce(audio_buffer + channels(channel_select) * count, channel_select);
+			count += extended_length;
+		}
+		return count;
+	}
+
+	// zero iterations skip the PAPR reduction, every iteration is one more clip and filter pass
+	void configure(const uint8_t *payload, const int8_t *call_sign, int carrier_frequency, int noise_symbols, bool fancy_header, int iterations) final {
 		int len = 0;
 		while (len <= 128 && payload[len])
 			++len;
@@ -289,14 +501,31 @@ public:
 			operation_mode = 14;
 		carrier_offset = (carrier_frequency * symbol_length) / RATE;
 		meta_data = (base37(call_sign) << 8) | operation_mode;
+		papr_iterations = std::max(iterations, 0);
+		if (cache_offset != carrier_offset || cache_call != meta_data >> 8 || cache_iterations != papr_iterations) {
+			cache_offset = carrier_offset;
+			cache_call = meta_data >> 8;
+			cache_iterations = papr_iterations;
+			for (int i = 0; i < cache_count; ++i)
+				cached[i] = false;
+		}
+		if (cache_noise != noise_symbols) {
+			cache_noise = noise_symbols;
+			for (int i = 1 + cached_noise; i < cache_count; ++i)
+				cached[i] = false;
+		}
 		for (int i = 0; i < 9; ++i)
 			call[i] = 0;
 		for (int i = 0; i < 9 && call_sign[i]; ++i)
 			call[i] = base37_map(call_sign[i]);
 		symbol_number = 0;
 		count_down = 5;
-		fancy_line = 11 * fancy_header;
+		fancy_line = fancy_lines * fancy_header;
 		noise_count = noise_symbols;
+		noise_total = noise_symbols;
+		noise_seq.reset();
+		papr_peak = 0;
+		papr_nanos = 0;
 		for (int i = 0; i < guard_length; ++i)
 			guard[i] = 0;
 		const uint32_t *frozen_bits;
@@ -1106,18 +1106,60 @@ struct Dit<31, BINS, STRIDE, TYPE, SIGN>
 	}
 };
 
+template <int BINS, typename TYPE, int SIGN>
+class Twiddles
+{
+	typedef typename TYPE::value_type value_type;
+	TYPE z[BINS];
+	Twiddles()
+	{
+		for (int n = 0; n < BINS; ++n)
+			z[n] = TYPE(UnitCircle<value_type>::cos(n, BINS), SIGN * UnitCircle<value_type>::sin(n, BINS));
+	}
+public:
+	static const TYPE *table()
+	{
+		static const Twiddles twiddles;
+		return twiddles.z;
+	}
+};
+
+template <int BINS, typename TYPE, int SIGN>
+class SplitFactors
+{
+	typedef typename TYPE::value_type value_type;
+	static const int N = BINS / 2;
+	SplitFactors()
+	{
+		value_type scale = SIGN < 0 ? value_type(0.5) : value_type(1);
+		for (int n = 0; n < N; ++n) {
+			TYPE sincos(
+				UnitCircle<value_type>::sin(n, BINS),
+				-SIGN * UnitCircle<value_type>::cos(n, BINS)
+			);
+			A[n] = scale * (TYPE(1) - sincos);
+			B[n] = scale * (TYPE(1) + sincos);
+		}
+	}
+public:
+	TYPE A[N], B[N];
+	static const SplitFactors &table()
+	{
+		static const SplitFactors factors;
+		return factors;
+	}
+};
+
 }
 
 template <int BINS, typename TYPE, int SIGN>
 class FastFourierTransform
 {
-	TYPE factors[BINS];
+	const TYPE *factors;
 public:
 	typedef typename TYPE::value_type value_type;
-	FastFourierTransform()
+	FastFourierTransform() : factors(FFT::Twiddles<BINS, TYPE, SIGN>::table())
 	{
-		for (int n = 0; n < BINS; ++n)
-			factors[n] = TYPE(UnitCircle<value_type>::cos(n, BINS), SIGN * UnitCircle<value_type>::sin(n, BINS));
 	}
 	inline void operator ()(TYPE *out, const TYPE *in)
 	{
@@ -1130,22 +1172,14 @@ class RealToHalfComplexTransform
 {
 	static_assert(BINS%2==0, "BINS must be even");
 	static const int N = BINS / 2;
-	TYPE factors[N];
-	TYPE A[N], B[N];
+	const TYPE *factors, *A, *B;
 public:
 	typedef typename TYPE::value_type value_type;
-	RealToHalfComplexTransform()
+	RealToHalfComplexTransform() :
+		factors(FFT::Twiddles<N, TYPE, -1>::table()),
+		A(FFT::SplitFactors<BINS, TYPE, -1>::table().A),
+		B(FFT::SplitFactors<BINS, TYPE, -1>::table().B)
 	{
-		for (int n = 0; n < N; ++n)
-			factors[n] = TYPE(UnitCircle<value_type>::cos(n, N), -UnitCircle<value_type>::sin(n, N));
-		for (int n = 0; n < N; ++n) {
-			TYPE sincos(
-				UnitCircle<value_type>::sin(n, BINS),
-				UnitCircle<value_type>::cos(n, BINS)
-			);
-			A[n] = value_type(0.5) * (TYPE(1) - sincos);
-			B[n] = value_type(0.5) * (TYPE(1) + sincos);
-		}
 	}
 	inline void operator ()(TYPE *out, const value_type *in)
 	{
@@ -1160,5 +1194,31 @@ public:
 	}
 };
 
+template <int BINS, typename TYPE>
+class HalfComplexToRealTransform
+{
+	static_assert(BINS%2==0, "BINS must be even");
+	static const int N = BINS / 2;
+	const TYPE *factors, *A, *B;
+	TYPE tmp[N];
+public:
+	typedef typename TYPE::value_type value_type;
+	HalfComplexToRealTransform() :
+		factors(FFT::Twiddles<N, TYPE, 1>::table()),
+		A(FFT::SplitFactors<BINS, TYPE, 1>::table().A),
+		B(FFT::SplitFactors<BINS, TYPE, 1>::table().B)
+	{
+	}
+	inline void operator ()(value_type *out, const TYPE *in)
+	{
+		tmp[0] = TYPE(in[0].real() + in[N].real(), in[0].real() - in[N].real());
+		for (int i = 1; i <= N/2; ++i) {
+			tmp[i] = in[i]*A[i] + conj(in[N-i])*B[i];
+			tmp[N-i] = in[N-i]*A[N-i] + conj(in[i])*B[N-i];
+		}
+		FFT::Dit<FFT::split(N), N, 1, TYPE, 1>::dit(reinterpret_cast<TYPE *>(out), tmp, factors);
+	}
+};
+
 }
 
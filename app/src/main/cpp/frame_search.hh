@@ -0,0 +1,243 @@
+/*
+Bulk frame search in stored recordings
+
+Copyright 2022 Ahmet Inan <inan@aicodix.de>
+*/
+
+#pragma once
+
+#include <vector>
+#include "archive_scan.hh"
+
+// sample, index and phase are the timing peak as SchmidlCox::refine expects it
+struct FrameCandidate {
+	int64_t position;
+	float cfo;
+	float metric;
+	int64_t sample;
+	int index;
+	float phase;
+};
+
+struct FrameSearchInterface {
+	virtual void search(std::vector<FrameCandidate> &candidates, const MappedAudio &audio, int channel_select) = 0;
+
+	virtual void decode(std::vector<ArchiveMessage> &messages, const std::vector<FrameCandidate> &candidates, const MappedAudio &audio, int channel_select) = 0;
+
+	virtual ~FrameSearchInterface() = default;
+};
+
+template<int RATE>
+class FrameSearch : public FrameSearchInterface {
+	typedef DSP::Complex<float> cmplx;
+	typedef DSP::Const<float> Const;
+	static const int symbol_length = (1280 * RATE) / 8000;
+	static const int guard_length = symbol_length / 8;
+	static const int extended_length = symbol_length + guard_length;
+	static const int filter_length = (((33 * RATE) / 8000) & ~3) | 1;
+	static const int cor_seq_len = 127;
+	static const int cor_seq_off = 1 - cor_seq_len;
+	static const int cor_seq_poly = 0b10001001;
+	static const int buffer_length = 4 * extended_length;
+	static const int search_position = extended_length;
+	static const int correlator_length = symbol_length / 2;
+	static const int match_length = guard_length | 1;
+	static const int match_delay = (match_length - 1) / 2;
+	static const int newer_delay = buffer_length - 1 - search_position - 2 * correlator_length;
+	static const int chunk_length = 64 * extended_length;
+	static const int window_before = buffer_length + extended_length;
+	static const int window_after = 12 * extended_length;
+	typedef SchmidlCox<float, cmplx, search_position, correlator_length, guard_length> correlator_type;
+	DSP::FrontEnd<float, filter_length> front_end;
+	DSP::SchmittTrigger<float> threshold;
+	DSP::FallingEdgeTrigger falling;
+	cmplx kernel[correlator_length];
+	correlator_type correlator;
+	Decoder<RATE> decoder;
+	std::vector<cmplx> analytic, product, aligned;
+	std::vector<float> power, timing;
+	cmplx temp[extended_length];
+	double timing_max;
+	float phase_max;
+	int index_max;
+
+	static int nrz(bool bit) {
+		return 1 - 2 * bit;
+	}
+
+	static void corSeq(cmplx *freq) {
+		CODE::MLS seq(cor_seq_poly);
+		for (int i = 0; i < correlator_length; ++i)
+			freq[i] = 0;
+		for (int i = 0; i < cor_seq_len; ++i)
+			freq[(i + cor_seq_off / 2 + correlator_length) % correlator_length] = nrz(seq());
+	}
+
+	static int channel(const MappedAudio &audio, int channel_select) {
+		if (audio.channels == 1)
+			return 0;
+		return channel_select ? channel_select : 1;
+	}
+
+	// same conversion as Decoder::convert, analytic input bypasses the front end
+	cmplx convert(const MappedAudio &audio, int channel_select, int64_t i) {
+		const int16_t *samples = audio.samples;
+		if (i >= audio.frames)
+			return channel_select == 4 ? cmplx(0) : front_end(0);
+		switch (channel_select) {
+			case 1:
+				return front_end(2 * samples[2 * i]);
+			case 2:
+				return front_end(2 * samples[2 * i + 1]);
+			case 3:
+				return front_end((int) samples[2 * i] + (int) samples[2 * i + 1]);
+			case 4:
+				return cmplx(samples[2 * i], samples[2 * i + 1]) / 32768.f;
+		}
+		return front_end(2 * samples[i]);
+	}
+
+	// history of each array is as long as its longest look back
+	static void slide(std::vector<cmplx> &array, int history, int count) {
+		std::memmove(array.data(), array.data() + count, sizeof(cmplx) * history);
+	}
+
+	static void slide(std::vector<float> &array, int history, int count) {
+		std::memmove(array.data(), array.data() + count, sizeof(float) * history);
+	}
+
+	void peak(std::vector<FrameCandidate> &candidates, int64_t sample, const cmplx *samples) {
+		float phase = phase_max;
+		int index = index_max;
+		float metric = timing_max / match_length;
+		timing_max = 0;
+		index_max = 0;
+		if (!correlator.refine(samples, phase, index))
+			return;
+		int64_t position = sample - buffer_length + 1 + correlator.symbol_pos - (filter_length - 1) / 2;
+		candidates.push_back({position, correlator.cfo_rad * (RATE / Const::TwoPi()), metric, sample, index, phase});
+	}
+
+public:
+	FrameSearch() : threshold(0.17f * match_length, 0.19f * match_length), correlator(kernel) {
+		cmplx seq[correlator_length];
+		corSeq(seq);
+		correlator_type::kernel(kernel, seq);
+	}
+
+	// candidates come in order of their timing peak sample, metric is the normalized timing peak
+	void search(std::vector<FrameCandidate> &candidates, const MappedAudio &audio, int channel_select) final {
+		candidates.clear();
+		channel_select = channel(audio, channel_select);
+		front_end.reset();
+		threshold.reset();
+		falling.reset();
+		timing_max = 0;
+		phase_max = 0;
+		index_max = 0;
+		analytic.assign(buffer_length + chunk_length, 0);
+		product.assign(correlator_length + chunk_length, 0);
+		power.assign(2 * correlator_length + chunk_length, 0);
+		timing.assign(match_length + chunk_length, 0);
+		aligned.assign(match_delay + chunk_length, 0);
+		DSP::Complex<double> cor_sum = 0;
+		double pwr_sum = 0, match_sum = 0;
+		float min_R = 0.00001 * correlator_length;
+		int64_t total = audio.frames + buffer_length;
+		for (int64_t begin = 0; begin < total; begin += chunk_length) {
+			int count = std::min<int64_t>(chunk_length, total - begin);
+			cmplx *x = analytic.data() + buffer_length;
+			for (int i = 0; i < count; ++i)
+				x[i] = convert(audio, channel_select, begin + i);
+			cmplx *q = product.data() + correlator_length;
+			float *p = power.data() + 2 * correlator_length;
+			for (int i = 0; i < count; ++i) {
+				cmplx newer = x[i - newer_delay], older = x[i - newer_delay - correlator_length];
+				q[i] = older * conj(newer);
+				p[i] = norm(newer);
+			}
+			float *t = timing.data() + match_length;
+			cmplx *P = aligned.data() + match_delay;
+			for (int i = 0; i < count; ++i) {
+				cor_sum += DSP::Complex<double>(q[i].real(), q[i].imag()) - DSP::Complex<double>(q[i - correlator_length].real(), q[i - correlator_length].imag());
+				pwr_sum += p[i] - p[i - 2 * correlator_length];
+				P[i] = cmplx(cor_sum.real(), cor_sum.imag());
+				float R = std::max(float(0.5 * pwr_sum), min_R);
+				t[i] = norm(P[i]) / (R * R);
+				match_sum += t[i] - t[i - match_length];
+				bool collect = threshold(match_sum);
+				bool process = falling(collect);
+				if (!collect && !process)
+					continue;
+				if (timing_max < match_sum) {
+					timing_max = match_sum;
+					phase_max = arg(P[i - match_delay]);
+					index_max = match_delay;
+				} else if (index_max < correlator_length + guard_length + match_delay) {
+					++index_max;
+				}
+				if (process)
+					peak(candidates, begin + i, x + i - buffer_length + 1);
+			}
+			slide(analytic, buffer_length, count);
+			slide(product, correlator_length, count);
+			slide(power, 2 * correlator_length, count);
+			slide(timing, match_length, count);
+			slide(aligned, match_delay, count);
+		}
+	}
+
+	// runs the full decoder only on windows around the candidates, overlapping windows are merged
+	void decode(std::vector<ArchiveMessage> &messages, const std::vector<FrameCandidate> &candidates, const MappedAudio &audio, int channel_select) final {
+		messages.clear();
+		channel_select = channel(audio, channel_select);
+		for (size_t i = 0; i < candidates.size();) {
+			int64_t begin = std::max<int64_t>(0, candidates[i].sample - window_before);
+			int64_t end = candidates[i].sample + window_after;
+			size_t next = i + 1;
+			for (; next < candidates.size() && candidates[next].sample - window_before < end; ++next)
+				end = candidates[next].sample + window_after;
+			front_end.reset();
+			decoder.reset();
+			for (int64_t block = begin; block < end; block += extended_length) {
+				SyncPeak peaks[8];
+				int peak_count = 0;
+				for (; i < next && candidates[i].sample < block + extended_length; ++i)
+					if (peak_count < 8)
+						peaks[peak_count++] = {int(candidates[i].sample - block), candidates[i].index, candidates[i].phase};
+				for (int k = 0; k < extended_length; ++k)
+					temp[k] = convert(audio, channel_select, block + k);
+				if (!decoder.feed(temp, extended_length, peaks, peak_count))
+					continue;
+				for (int status = decoder.process(); status != STATUS_OKAY; status = decoder.process()) {
+					if (status != STATUS_DONE && status != STATUS_PING)
+						continue;
+					ArchiveMessage message = {};
+					message.position = block + extended_length;
+					decoder.staged(&message.cfo, &message.mode, message.call);
+					if (status == STATUS_DONE && decoder.fetch(message.payload) < 0)
+						continue;
+					messages.push_back(message);
+				}
+			}
+			i = next;
+		}
+	}
+};
+
+static FrameSearchInterface *create_search(int rate) {
+	switch (rate) {
+		case 8000:
+			return new(std::nothrow) FrameSearch<8000>();
+		case 16000:
+			return new(std::nothrow) FrameSearch<16000>();
+		case 32000:
+			return new(std::nothrow) FrameSearch<32000>();
+		case 44100:
+			return new(std::nothrow) FrameSearch<44100>();
+		case 48000:
+			return new(std::nothrow) FrameSearch<48000>();
+	}
+	return nullptr;
+}
+
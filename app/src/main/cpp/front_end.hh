@@ -0,0 +1,147 @@
+/*
+Analytic signal front end in floating and fixed point
+
+Copyright 2022 Ahmet Inan <inan@aicodix.de>
+*/
+
+#pragma once
+
+#include "complex.hh"
+#include "blockdc.hh"
+#include "hilbert.hh"
+#include "window.hh"
+#include "simd.hh"
+
+namespace DSP {
+
+template <typename TYPE, int TAPS>
+class FrontEnd;
+
+template <int TAPS>
+class FrontEnd<float, TAPS>
+{
+	typedef Complex<float> complex_type;
+	BlockDC<float, float> block_dc;
+	Hilbert<complex_type, TAPS> hilbert;
+public:
+	FrontEnd()
+	{
+		block_dc.samples(TAPS);
+	}
+	void reset()
+	{
+		block_dc.reset();
+		hilbert.reset();
+	}
+	complex_type operator()(int32_t input)
+	{
+		return hilbert(block_dc(input / 65536.f));
+	}
+};
+
+// Q15 coefficients on a Q14 signal saturated at full scale: the imaginary taps sum up to
+// less than 3.2 even at 48000 Hz, so every sum stays below 3.2 * 2^29 and fits in 32 bits
+template <int TAPS>
+class FrontEnd<int16_t, TAPS>
+{
+	static_assert((TAPS-1) % 4 == 0, "TAPS-1 not divisible by four");
+	typedef Complex<float> complex_type;
+	static const int HALF = (TAPS-1) / 2;
+	static const int16_t LIMIT = 1 << 14;
+	int16_t real[2*TAPS];
+	int16_t imco[(TAPS-1)/4];
+	int16_t reco, a, b;
+	int16_t x1, y1;
+	int pos;
+	static int16_t q15(float v)
+	{
+		return std::min<float>(std::nearbyint(32768 * v), 32767);
+	}
+public:
+	FrontEnd() : x1(0), y1(0), pos(0)
+	{
+		float fa = float(TAPS - 1) / float(TAPS);
+		a = q15(fa);
+		b = q15((1 + fa) / 2);
+		Kaiser<float> win(2);
+		reco = q15(win(HALF, TAPS));
+		for (int i = 0; i < (TAPS-1)/4; ++i)
+			imco[i] = q15(win((2*i+1)+HALF, TAPS) * 2 / ((2*i+1) * Const<float>::Pi()));
+		reset();
+	}
+	void reset()
+	{
+		x1 = y1 = 0;
+		pos = 0;
+		for (int i = 0; i < 2*TAPS; ++i)
+			real[i] = 0;
+	}
+	// input in Q16 like the float front end, output scaled back from Q29
+	complex_type operator()(int32_t input)
+	{
+		int16_t x0 = input >> 2;
+		int32_t y0 = (b * (x0 - x1) + a * y1 + (1 << 14)) >> 15;
+		x1 = x0;
+		y1 = std::clamp<int32_t>(y0, -LIMIT, LIMIT - 1);
+		const int16_t *x = real + pos;
+		int32_t re = reco * x[HALF];
+		int32_t im = 0;
+		for (int i = 0; i < (TAPS-1)/4; ++i)
+			im += imco[i] * (x[HALF-(2*i+1)] - x[HALF+(2*i+1)]);
+		real[pos] = real[pos+TAPS] = y1;
+		if (++pos >= TAPS)
+			pos = 0;
+		return complex_type(re, im) / 536870912.f;
+	}
+};
+
+template <int LANES, int TAPS>
+class FrontEndLanes
+{
+	static_assert((TAPS-1) % 4 == 0, "TAPS-1 not divisible by four");
+	typedef SIMD<float, LANES> simd;
+	static const int HALF = (TAPS-1) / 2;
+	simd real[2*TAPS];
+	float imco[(TAPS-1)/4];
+	float reco, a, b;
+	simd x1, y1;
+	int pos;
+public:
+	FrontEndLanes() : pos(0)
+	{
+		a = float(TAPS - 1) / float(TAPS);
+		b = (1 + a) / 2;
+		Kaiser<float> win(2);
+		reco = win((TAPS-1)/2, TAPS);
+		for (int i = 0; i < (TAPS-1)/4; ++i)
+			imco[i] = win((2*i+1)+(TAPS-1)/2, TAPS) * 2 / ((2*i+1) * Const<float>::Pi());
+		reset();
+	}
+	void reset()
+	{
+		x1 = y1 = vzero<simd>();
+		pos = 0;
+		for (int i = 0; i < 2*TAPS; ++i)
+			real[i] = vzero<simd>();
+	}
+	void operator()(simd *re, simd *im, const int16_t *input)
+	{
+		simd x0;
+		for (int k = 0; k < LANES; ++k)
+			x0.v[k] = 2 * input[k] / 65536.f;
+		simd y0 = vadd(vmul(vdup<simd>(b), vsub(x0, x1)), vmul(vdup<simd>(a), y1));
+		x1 = x0;
+		y1 = y0;
+		const simd *x = real + pos;
+		*re = vmul(vdup<simd>(reco), x[HALF]);
+		*im = vmul(vdup<simd>(imco[0]), vsub(x[HALF-1], x[HALF+1]));
+		for (int i = 1; i < (TAPS-1)/4; ++i)
+			*im = vadd(*im, vmul(vdup<simd>(imco[i]), vsub(x[HALF-(2*i+1)], x[HALF+(2*i+1)])));
+		real[pos] = real[pos+TAPS] = y0;
+		if (++pos >= TAPS)
+			pos = 0;
+	}
+};
+
+}
+
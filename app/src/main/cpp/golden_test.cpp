@@ -0,0 +1,588 @@
+/*
+Golden vector regression tests for the host build
+
+Copyright 2022 Ahmet Inan <inan@aicodix.de>
+*/
+
+#include <cassert>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <algorithm>
+#include <chrono>
+#include <string>
+#include <utility>
+#include <vector>
+#include <unistd.h>
+#include "batch_encoder.hh"
+#include "decode_server.hh"
+#include "replay.hh"
+
+struct Setup {
+	int carrier_frequency;
+	int noise_symbols;
+	bool fancy_header;
+	int channel_select;
+};
+
+// the second setup exercises noise, the fancy header and the analytic I/Q output
+static const Setup setups[] = {{1500, 0, false, 0}, {2000, 2, true, 4}};
+static const int rates[] = {8000, 16000, 32000, 44100, 48000};
+static const int modes[] = {0, 16, 15, 14};
+
+// impaired captures at 8000 Hz, replayed through replay()
+struct Impairment {
+	const char *name;
+	int mode;
+	int offset;
+	float cfo;
+	float echo;
+	int delay;
+	float snr;
+	int channel_select;
+};
+
+static const Impairment impairments[] = {
+	{"ping-clean.rgc", 0, 1440, 0, 0, 0, 100, 0},
+	{"mode16-clean.rgc", 16, 1440, 0, 0, 0, 100, 0},
+	{"mode16-noisy.rgc", 16, 2217, 23.4f, 0, 0, 6, 0},
+	{"mode14-echo.rgc", 14, 1955, -11.f, 0.5f, 16, 15, 0},
+	{"mode15-stereo.rgc", 15, 1603, 7.5f, 0, 0, 10, 2},
+};
+
+static const char *call_sign = "GOLDEN";
+
+// mode 16 takes up to 85 bytes, mode 15 up to 128 and mode 14 up to 170
+static void message(uint8_t *payload, int mode) {
+	const char *text = "The quick brown fox jumps over the lazy dog. ";
+	int length = 0;
+	switch (mode) {
+		case 14:
+			length = 170;
+			break;
+		case 15:
+			length = 120;
+			break;
+		case 16:
+			length = 64;
+			break;
+	}
+	std::memset(payload, 0, 171);
+	for (int i = 0; i < length; ++i)
+		payload[i] = text[i % std::strlen(text)];
+}
+
+// FNV-1a over the little endian bytes
+static uint64_t digest(const uint8_t *bytes, int count) {
+	uint64_t hash = 0xcbf29ce484222325;
+	for (int i = 0; i < count; ++i) {
+		hash ^= bytes[i];
+		hash *= 0x100000001b3;
+	}
+	return hash;
+}
+
+static uint64_t digest(const int16_t *samples, int count) {
+	std::vector<uint8_t> bytes(2 * count);
+	for (int i = 0; i < count; ++i) {
+		bytes[2 * i] = uint16_t(samples[i]);
+		bytes[2 * i + 1] = uint16_t(samples[i]) >> 8;
+	}
+	return digest(bytes.data(), bytes.size());
+}
+
+static uint64_t digest(const uint8_t *payload) {
+	return digest(payload, strnlen(reinterpret_cast<const char *>(payload), 170));
+}
+
+static std::vector<int16_t> render(EncoderInterface *encoder, int mode, const Setup &setup) {
+	uint8_t payload[171];
+	message(payload, mode);
+	encoder->configure(payload, reinterpret_cast<const int8_t *>(call_sign), setup.carrier_frequency, setup.noise_symbols, setup.fancy_header, 1);
+	std::vector<int16_t> audio(EncoderInterface::channels(setup.channel_select) * encoder->length());
+	encoder->render(audio.data(), setup.channel_select);
+	return audio;
+}
+
+static std::vector<std::string> lines(const std::string &path) {
+	std::vector<std::string> result;
+	FILE *file = fopen(path.c_str(), "r");
+	if (!file)
+		return result;
+	char line[256];
+	while (fgets(line, sizeof(line), file)) {
+		line[strcspn(line, "\n")] = 0;
+		if (line[0] && line[0] != '#')
+			result.push_back(line);
+	}
+	fclose(file);
+	return result;
+}
+
+static bool store(const std::string &path, const char *comment, const std::vector<std::string> &result) {
+	FILE *file = fopen(path.c_str(), "w");
+	if (!file)
+		return false;
+	fprintf(file, "# %s\n", comment);
+	for (const std::string &line: result)
+		fprintf(file, "%s\n", line.c_str());
+	return !fclose(file);
+}
+
+// renders every mode at every rate twice and once more in a batch, all must give the same samples
+static int encoder_vectors(const std::string &directory, bool update) {
+	std::vector<std::string> result;
+	for (int rate: rates) {
+		EncoderInterface *encoder = create_encoder(rate);
+		BatchEncoder batch(rate, 2);
+		for (const Setup &setup: setups) {
+			uint8_t payloads[sizeof(modes) / sizeof(*modes)][171];
+			std::vector<EncoderJob> jobs;
+			for (int mode: modes) {
+				message(payloads[jobs.size()], mode);
+				jobs.push_back({payloads[jobs.size()], reinterpret_cast<const int8_t *>(call_sign),
+					setup.carrier_frequency, setup.noise_symbols, setup.fancy_header, 1, {}});
+			}
+			batch(jobs.data(), jobs.size(), setup.channel_select);
+			for (size_t i = 0; i < jobs.size(); ++i) {
+				int mode = modes[i];
+				std::vector<int16_t> first = render(encoder, mode, setup);
+				std::vector<int16_t> second = render(encoder, mode, setup);
+				if (first != second || first != jobs[i].audio) {
+					fprintf(stderr, "encoder at %d Hz not repeatable for mode %d channel %d\n", rate, mode, setup.channel_select);
+					delete encoder;
+					return 1;
+				}
+				char line[256];
+				snprintf(line, sizeof(line), "%d %d %d %d %d %d %zu %016llx", rate, mode, setup.carrier_frequency,
+					setup.noise_symbols, setup.fancy_header, setup.channel_select, first.size(),
+					(unsigned long long)digest(first.data(), first.size()));
+				result.push_back(line);
+			}
+		}
+		delete encoder;
+	}
+	std::string path = directory + "/encoder.txt";
+	if (update)
+		return !store(path, "rate mode carrier noise fancy channel samples digest", result);
+	std::vector<std::string> expected = lines(path);
+	int failed = 0;
+	for (size_t i = 0; i < std::max(result.size(), expected.size()); ++i) {
+		if (i < result.size() && i < expected.size() && result[i] == expected[i])
+			continue;
+		fprintf(stderr, "encoder expected \"%s\" got \"%s\"\n", i < expected.size() ? expected[i].c_str() : "",
+			i < result.size() ? result[i].c_str() : "");
+		++failed;
+	}
+	return failed;
+}
+
+struct Decoded {
+	int status = STATUS_OKAY;
+	int count = 0;
+	int32_t mode = -1;
+	uint8_t call[10] = {};
+	uint8_t payload[171] = {};
+};
+
+static void collect(DecoderInterface *decoder, int status, Decoded *decoded) {
+	if (status != STATUS_DONE && status != STATUS_PING && status != STATUS_FAIL && status != STATUS_NOPE)
+		return;
+	++decoded->count;
+	decoded->status = status;
+	float cfo;
+	decoder->staged(&cfo, &decoded->mode, decoded->call);
+	if (status == STATUS_DONE && decoder->fetch(decoded->payload) < 0)
+		decoded->status = STATUS_FAIL;
+}
+
+static bool expected(const Decoded &decoded, int mode) {
+	uint8_t payload[171];
+	message(payload, mode);
+	const char *sign = reinterpret_cast<const char *>(decoded.call);
+	while (*sign == ' ')
+		++sign;
+	return decoded.count == 1 && decoded.status == (mode ? STATUS_DONE : STATUS_PING)
+		&& decoded.mode == mode && !std::strcmp(sign, call_sign)
+		&& (!mode || !std::memcmp(decoded.payload, payload, 170));
+}
+
+static double seconds(std::chrono::steady_clock::time_point start) {
+	return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+// every mode at every rate must decode from the encoder output, behind a fractional block offset
+static int round_trips(double *audio_time, double *decode_time) {
+	int failed = 0;
+	for (int rate: rates) {
+		EncoderInterface *encoder = create_encoder(rate);
+		DecoderInterface *decoder = create_decoder(rate);
+		int extended_length = (1280 * rate / 8000) * 9 / 8;
+		for (const Setup &setup: setups) {
+			int channels = EncoderInterface::channels(setup.channel_select);
+			for (int mode: modes) {
+				std::vector<int16_t> audio = render(encoder, mode, setup);
+				int lead = extended_length + 123 * rate / 8000;
+				int frames = (lead + audio.size() / channels + 8 * extended_length) / extended_length * extended_length;
+				std::vector<int16_t> stream(channels * frames);
+				std::copy(audio.begin(), audio.end(), stream.begin() + channels * lead);
+				Decoded decoded;
+				decoder->reset();
+				auto start = std::chrono::steady_clock::now();
+				for (int i = 0; i < frames; i += extended_length) {
+					if (!decoder->feed(stream.data() + channels * i, extended_length, setup.channel_select))
+						continue;
+					for (int status = decoder->process(); status != STATUS_OKAY; status = decoder->process())
+						collect(decoder, status, &decoded);
+				}
+				*decode_time += seconds(start);
+				*audio_time += double(frames) / rate;
+				if (!expected(decoded, mode)) {
+					fprintf(stderr, "round trip at %d Hz failed for mode %d channel %d\n", rate, mode, setup.channel_select);
+					++failed;
+				}
+			}
+		}
+		delete decoder;
+		delete encoder;
+	}
+	return failed;
+}
+
+static float gauss(CODE::Xorshift32 &prng) {
+	float u = (prng() + 1.f) / 4294967296.f;
+	float v = prng() / 4294967296.f;
+	return std::sqrt(-2.f * std::log(u)) * std::cos(DSP::Const<float>::TwoPi() * v);
+}
+
+// shifts, echoes and buries the analytic signal in noise, keeps the real part
+static std::vector<int16_t> impair(const Impairment &impairment, int rate) {
+	typedef DSP::Complex<float> cmplx;
+	EncoderInterface *encoder = create_encoder(rate);
+	std::vector<int16_t> iq = render(encoder, impairment.mode, {1500, 0, false, 4});
+	delete encoder;
+	int extended_length = (1280 * rate / 8000) * 9 / 8;
+	int length = iq.size() / 2;
+	int frames = impairment.offset + length + 2 * extended_length;
+	std::vector<float> signal(frames);
+	DSP::Phasor<cmplx> nco;
+	nco.freq(impairment.cfo / rate);
+	float power = 0;
+	for (int i = 0; i < length; ++i) {
+		cmplx value(iq[2 * i], iq[2 * i + 1]);
+		if (impairment.echo && i >= impairment.delay)
+			value += impairment.echo * cmplx(iq[2 * (i - impairment.delay)], iq[2 * (i - impairment.delay) + 1]);
+		value *= nco();
+		signal[impairment.offset + i] = 0.5f * value.real();
+		power += signal[impairment.offset + i] * signal[impairment.offset + i];
+	}
+	float sigma = std::sqrt(power / length * std::pow(10.f, -impairment.snr / 10));
+	CODE::Xorshift32 prng;
+	int channels = impairment.channel_select ? 2 : 1;
+	std::vector<int16_t> audio(channels * frames);
+	for (int i = 0; i < frames; ++i) {
+		for (int c = 0; c < channels; ++c) {
+			float value = sigma * gauss(prng);
+			if (c == channels - 1)
+				value += signal[i];
+			audio[channels * i + c] = std::nearbyint(std::min(std::max(value, -32768.f), 32767.f));
+		}
+	}
+	return audio;
+}
+
+// records the impaired signals through the capture trigger of a decoder
+static int generate(const std::string &directory) {
+	const int rate = 8000;
+	int extended_length = (1280 * rate / 8000) * 9 / 8;
+	std::vector<std::string> result;
+	for (const Impairment &impairment: impairments) {
+		std::vector<int16_t> audio = impair(impairment, rate);
+		int channels = impairment.channel_select ? 2 : 1;
+		int frames = audio.size() / channels;
+		audio.resize(channels * (frames + 8 * extended_length), 0);
+		DecoderInterface *decoder = create_decoder(rate);
+		std::string path = directory + "/capture-8000-0000.rgc";
+		unlink(path.c_str());
+		decoder->capture(directory.c_str(), CAPTURE_SYNC);
+		for (int i = 0; i + extended_length <= frames + 8 * extended_length; i += extended_length)
+			if (decoder->feed(audio.data() + channels * i, extended_length, impairment.channel_select))
+				while (decoder->process() != STATUS_OKAY);
+		delete decoder;
+		std::string name = directory + "/" + impairment.name;
+		if (rename(path.c_str(), name.c_str())) {
+			fprintf(stderr, "no capture for %s\n", impairment.name);
+			return 1;
+		}
+		uint8_t payload[171];
+		message(payload, impairment.mode);
+		char line[256];
+		snprintf(line, sizeof(line), "%s %d %d %s %016llx", impairment.name, rate, impairment.mode, call_sign,
+			(unsigned long long)digest(payload));
+		result.push_back(line);
+	}
+	return !store(directory + "/decoder.txt", "file rate mode call digest", result);
+}
+
+// every capture must decode to exactly the recorded message and nothing else, with either front end
+static int captures(const std::string &directory, bool fixed, double *audio_time, double *decode_time) {
+	std::vector<std::string> expected = lines(directory + "/decoder.txt");
+	if (expected.empty()) {
+		fprintf(stderr, "no captures listed in %s/decoder.txt\n", directory.c_str());
+		return 1;
+	}
+	int failed = 0;
+	for (const std::string &line: expected) {
+		char name[128], sign[16];
+		int rate, mode;
+		unsigned long long hash;
+		if (sscanf(line.c_str(), "%127s %d %d %15s %llx", name, &rate, &mode, sign, &hash) != 5) {
+			fprintf(stderr, "malformed line \"%s\"\n", line.c_str());
+			++failed;
+			continue;
+		}
+		DecoderInterface *decoder = create_decoder(rate, fixed);
+		if (!decoder) {
+			fprintf(stderr, "unsupported rate in \"%s\"\n", line.c_str());
+			++failed;
+			continue;
+		}
+		Decoded decoded;
+		CaptureHeader header;
+		auto start = std::chrono::steady_clock::now();
+		bool okay = replay(decoder, (directory + "/" + name).c_str(), &header, [&](int status) {
+			collect(decoder, status, &decoded);
+		});
+		*decode_time += seconds(start);
+		delete decoder;
+		if (!okay) {
+			fprintf(stderr, "could not replay %s\n", name);
+			++failed;
+			continue;
+		}
+		*audio_time += double(header.frames) / rate;
+		const char *call = reinterpret_cast<const char *>(decoded.call);
+		while (*call == ' ')
+			++call;
+		if (decoded.count != 1 || decoded.status != (mode ? STATUS_DONE : STATUS_PING) || decoded.mode != mode
+				|| std::strcmp(call, sign) || digest(decoded.payload) != hash) {
+			fprintf(stderr, "capture %s decoded %d messages with the %s front end, last status %d mode %d call \"%s\"\n",
+				name, decoded.count, fixed ? "fixed point" : "float", decoded.status, decoded.mode, call);
+			++failed;
+		}
+	}
+	return failed;
+}
+
+// the mono captures, one per lane and each behind its own delay, must decode alike through MultiDecoder
+static int lanes(const std::string &directory) {
+	struct Lane {
+		std::string name, sign;
+		int mode;
+		uint64_t hash;
+		std::vector<int16_t> audio;
+	};
+	std::vector<Lane> captures;
+	for (const std::string &line: lines(directory + "/decoder.txt")) {
+		char name[128], sign[16];
+		int rate, mode;
+		unsigned long long hash;
+		CaptureHeader header;
+		if (sscanf(line.c_str(), "%127s %d %d %15s %llx", name, &rate, &mode, sign, &hash) != 5 || rate != 8000)
+			continue;
+		FILE *file = fopen((directory + "/" + name).c_str(), "rb");
+		if (!file)
+			continue;
+		std::vector<int16_t> audio;
+		if (fread(&header, sizeof(header), 1, file) == 1 && header.channels == 1) {
+			audio.resize(header.frames);
+			audio.resize(fread(audio.data(), sizeof(int16_t), audio.size(), file));
+		}
+		fclose(file);
+		if (!audio.empty())
+			captures.push_back({name, sign, mode, hash, audio});
+	}
+	MultiDecoderInterface *decoder = create_multi_decoder(8000);
+	if (captures.empty() || !decoder) {
+		delete decoder;
+		fprintf(stderr, "no mono captures to decode in lanes\n");
+		return 1;
+	}
+	const int extended_length = 1440;
+	std::vector<int> delays(multi_lanes);
+	size_t frames = 0;
+	for (int k = 0; k < multi_lanes; ++k) {
+		delays[k] = 337 * k;
+		frames = std::max(frames, delays[k] + captures[k % captures.size()].audio.size());
+	}
+	std::vector<int16_t> block(multi_lanes * extended_length);
+	std::vector<Decoded> decoded(multi_lanes);
+	for (size_t i = 0; i < frames + 4 * extended_length; i += extended_length) {
+		for (int j = 0; j < extended_length; ++j) {
+			for (int k = 0; k < multi_lanes; ++k) {
+				const std::vector<int16_t> &audio = captures[k % captures.size()].audio;
+				size_t n = i + j - delays[k];
+				block[multi_lanes * j + k] = i + j >= size_t(delays[k]) && n < audio.size() ? audio[n] : 0;
+			}
+		}
+		decoder->feed(block.data(), extended_length, (1 << multi_lanes) - 1);
+		for (int k = 0; k < multi_lanes; ++k) {
+			DecoderInterface *lane = decoder->lane(k);
+			for (int status = lane->process(); status != STATUS_OKAY; status = lane->process())
+				collect(lane, status, &decoded[k]);
+		}
+	}
+	delete decoder;
+	int failed = 0;
+	for (int k = 0; k < multi_lanes; ++k) {
+		const Lane &capture = captures[k % captures.size()];
+		const char *call = reinterpret_cast<const char *>(decoded[k].call);
+		while (*call == ' ')
+			++call;
+		if (decoded[k].count != 1 || decoded[k].status != (capture.mode ? STATUS_DONE : STATUS_PING) || decoded[k].mode != capture.mode
+				|| capture.sign != call || digest(decoded[k].payload) != capture.hash) {
+			fprintf(stderr, "lane %d with %s decoded %d messages, last status %d mode %d call \"%s\"\n",
+				k, capture.name.c_str(), decoded[k].count, decoded[k].status, decoded[k].mode, call);
+			++failed;
+		}
+	}
+	return failed;
+}
+
+// decodes a mono stream and returns the carrier frequency and SNR of every frame in the order reported
+static std::vector<std::pair<float, float>> reported(DecoderInterface *decoder, const std::vector<int16_t> &stream, int extended_length) {
+	std::vector<std::pair<float, float>> result;
+	decoder->reset();
+	for (size_t i = 0; i + extended_length <= stream.size(); i += extended_length) {
+		if (!decoder->feed(stream.data() + i, extended_length, 0))
+			continue;
+		for (int status = decoder->process(); status != STATUS_OKAY; status = decoder->process()) {
+			if (status != STATUS_DONE)
+				continue;
+			float cfo, quality[QUALITY_COUNT], carrier_snr[256];
+			int32_t mode, events[EVENT_COUNT];
+			uint8_t call[10], payload[171];
+			decoder->staged(&cfo, &mode, call);
+			decoder->metrics(events, quality, carrier_snr, false);
+			if (decoder->fetch(payload) >= 0)
+				result.emplace_back(cfo, quality[QUALITY_SNR]);
+		}
+	}
+	return result;
+}
+
+// two bursts in flight at once must each report their own SNR, not that of whichever finished last
+static int overlaps() {
+	typedef DSP::Complex<float> cmplx;
+	const int rate = 8000;
+	int extended_length = (1280 * rate / 8000) * 9 / 8;
+	EncoderInterface *encoder = create_encoder(rate);
+	std::vector<int16_t> clean = render(encoder, 16, {1000, 0, false, 0});
+	std::vector<int16_t> noisy = render(encoder, 16, {2800, 0, false, 0});
+	delete encoder;
+	// both preambles are found in the same block, so both frames finish in the same block
+	int lead = extended_length + 870, shift = 1400;
+	int frames = (lead + shift + std::max(clean.size(), noisy.size()) + 8 * extended_length) / extended_length * extended_length;
+	float power = 0;
+	for (int16_t sample: clean)
+		power += 0.25f * sample * sample;
+	float sigma = std::sqrt(power / clean.size() * std::pow(10.f, -3.f));
+	// only the band of the second burst gets buried in extra noise
+	DSP::Phasor<cmplx> nco;
+	nco.freq(2800.f / rate);
+	CODE::Xorshift32 prng;
+	cmplx band[8];
+	std::vector<int16_t> streams[3];
+	for (std::vector<int16_t> &stream: streams)
+		stream.resize(frames);
+	for (int i = 0; i < frames; ++i) {
+		band[i % 8] = cmplx(gauss(prng), gauss(prng));
+		cmplx sum;
+		for (const cmplx &value: band)
+			sum += value;
+		float noise = sigma * gauss(prng), hiss = sigma * (sum * nco()).real();
+		float one = i >= lead && i - lead < int(clean.size()) ? 0.5f * clean[i - lead] : 0;
+		float two = i >= lead + shift && i - lead - shift < int(noisy.size()) ? 0.5f * noisy[i - lead - shift] : 0;
+		streams[0][i] = std::nearbyint(noise + hiss + one + two);
+		streams[1][i] = std::nearbyint(noise + hiss + one);
+		streams[2][i] = std::nearbyint(noise + hiss + two);
+	}
+	DecoderInterface *decoder = create_decoder(rate);
+	std::vector<std::pair<float, float>> both = reported(decoder, streams[0], extended_length);
+	std::vector<std::pair<float, float>> alone[2] = {
+		reported(decoder, streams[1], extended_length),
+		reported(decoder, streams[2], extended_length),
+	};
+	delete decoder;
+	if (both.size() != 2 || alone[0].size() != 1 || alone[1].size() != 1 || alone[0][0].second < alone[1][0].second + 6) {
+		fprintf(stderr, "overlapping bursts decoded %zu frames, alone %zu and %zu\n", both.size(), alone[0].size(), alone[1].size());
+		return 1;
+	}
+	int failed = 0;
+	for (const std::pair<float, float> &frame: both) {
+		const std::pair<float, float> &solo = alone[frame.first < 1900 ? 0 : 1][0];
+		if (std::abs(frame.second - solo.second) > 1) {
+			fprintf(stderr, "overlapping burst at %.0f Hz reported %.1f dB SNR, alone %.1f dB\n", frame.first, frame.second, solo.second);
+			++failed;
+		}
+	}
+	return failed;
+}
+
+static void usage(const char *name) {
+	fprintf(stderr, "usage: %s [-u] [-g] [-t MAX_RTF] DIRECTORY\n", name);
+	fprintf(stderr, "checks the encoder against DIRECTORY/encoder.txt and replays the captures listed in DIRECTORY/decoder.txt\n");
+	fprintf(stderr, "with -u the encoder digests and with -g the captures are regenerated first\n");
+}
+
+int main(int argc, char **argv) {
+	bool update = false;
+	bool regenerate = false;
+	double max_rtf = 0;
+	for (int opt; (opt = getopt(argc, argv, "ugt:h")) != -1;) {
+		switch (opt) {
+			case 'u':
+				update = true;
+				break;
+			case 'g':
+				regenerate = true;
+				break;
+			case 't':
+				max_rtf = std::atof(optarg);
+				break;
+			default:
+				usage(argv[0]);
+				return 1;
+		}
+	}
+	if (optind + 1 != argc) {
+		usage(argv[0]);
+		return 1;
+	}
+	std::string directory = argv[optind];
+	if (regenerate && generate(directory)) {
+		fprintf(stderr, "could not generate captures in %s\n", directory.c_str());
+		return 1;
+	}
+	int failed = encoder_vectors(directory, update);
+	double audio_time = 0, decode_time = 0;
+	failed += round_trips(&audio_time, &decode_time);
+	failed += captures(directory, false, &audio_time, &decode_time);
+	failed += captures(directory, true, &audio_time, &decode_time);
+	failed += lanes(directory);
+	failed += overlaps();
+	double rtf = decode_time / audio_time;
+	printf("decoded %.1f seconds of audio in %.3f seconds, real-time factor %.4f\n", audio_time, decode_time, rtf);
+	if (max_rtf > 0 && rtf > max_rtf) {
+		fprintf(stderr, "real-time factor %.4f exceeds %.4f\n", rtf, max_rtf);
+		++failed;
+	}
+	if (failed) {
+		fprintf(stderr, "%d golden checks failed\n", failed);
+		return 1;
+	}
+	printf("all golden checks passed\n");
+	return 0;
+}
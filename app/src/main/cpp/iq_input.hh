@@ -0,0 +1,149 @@
+/*
+Complex I/Q input at arbitrary rates for the decoder
+
+Copyright 2022 Ahmet Inan <inan@aicodix.de>
+*/
+
+#pragma once
+
+#include <cstring>
+#include "complex.hh"
+#include "phasor.hh"
+#include "resampler.hh"
+
+#define IQ_FORMAT_CU8 0
+#define IQ_FORMAT_CS16 1
+#define IQ_FORMAT_CF32 2
+
+class IQInput {
+	typedef DSP::Complex<float> cmplx;
+	DSP::Resampler<cmplx> resampler;
+	DSP::Phasor<cmplx> nco;
+	cmplx *block = nullptr;
+	cmplx *output = nullptr;
+	uint8_t pending[8];
+	int pending_count = 0;
+	int filled = 0;
+	int length = 0;
+	int format = IQ_FORMAT_CS16;
+	int input_rate = 0;
+	bool shift = false;
+
+	cmplx sample(const uint8_t *bytes) {
+		switch (format) {
+			case IQ_FORMAT_CU8:
+				return cmplx(bytes[0] - 127.5f, bytes[1] - 127.5f) / 128.f;
+			case IQ_FORMAT_CF32: {
+				float value[2];
+				std::memcpy(value, bytes, sizeof(value));
+				return cmplx(value[0], value[1]);
+			}
+		}
+		int16_t value[2];
+		std::memcpy(value, bytes, sizeof(value));
+		return cmplx(value[0], value[1]) / 32768.f;
+	}
+
+	template<typename FUNC>
+	void push(cmplx input, FUNC func) {
+		if (shift)
+			input *= nco();
+		for (int i = 0, count = resampler(output, input); i < count; ++i) {
+			block[filled++] = output[i];
+			if (filled == length) {
+				func(block);
+				filled = 0;
+			}
+		}
+	}
+
+public:
+	~IQInput() {
+		delete[] block;
+		delete[] output;
+	}
+
+	static int parse(const char *name) {
+		if (!std::strcmp(name, "cu8"))
+			return IQ_FORMAT_CU8;
+		if (!std::strcmp(name, "cs16"))
+			return IQ_FORMAT_CS16;
+		if (!std::strcmp(name, "cf32"))
+			return IQ_FORMAT_CF32;
+		return -1;
+	}
+
+	int bytes_per_sample() {
+		switch (format) {
+			case IQ_FORMAT_CU8:
+				return 2;
+			case IQ_FORMAT_CF32:
+				return 8;
+		}
+		return 4;
+	}
+
+	int rate() {
+		return input_rate;
+	}
+
+	// frequency is added to the input before resampling to block_length sized blocks at output_rate
+	bool setup(int iq_format, int iq_rate, int output_rate, float frequency, int block_length) {
+		if (iq_format < IQ_FORMAT_CU8 || iq_format > IQ_FORMAT_CF32 || !resampler.setup(iq_rate, output_rate))
+			return false;
+		delete[] block;
+		delete[] output;
+		block = new(std::nothrow) cmplx[block_length];
+		output = new(std::nothrow) cmplx[resampler.max_output()];
+		if (!block || !output)
+			return false;
+		format = iq_format;
+		input_rate = iq_rate;
+		length = block_length;
+		shift = frequency != 0;
+		nco.freq(frequency / iq_rate);
+		reset();
+		return true;
+	}
+
+	void reset() {
+		resampler.reset();
+		nco.reset();
+		pending_count = 0;
+		filled = 0;
+	}
+
+	// interleaved I/Q bytes of any count, func gets every completed block
+	template<typename FUNC>
+	void operator()(const uint8_t *bytes, int byte_count, FUNC func) {
+		int size = bytes_per_sample();
+		while (pending_count && byte_count) {
+			pending[pending_count++] = *bytes++;
+			--byte_count;
+			if (pending_count == size) {
+				push(sample(pending), func);
+				pending_count = 0;
+			}
+		}
+		if (pending_count)
+			return;
+		for (; byte_count >= size; bytes += size, byte_count -= size)
+			push(sample(bytes), func);
+		std::memcpy(pending, bytes, byte_count);
+		pending_count = byte_count;
+	}
+
+	// pads the last block with zeros and follows it with count more blocks of silence
+	template<typename FUNC>
+	void flush(int count, FUNC func) {
+		for (int i = filled; i < length; ++i)
+			block[i] = 0;
+		func(block);
+		for (int i = 0; i < length; ++i)
+			block[i] = 0;
+		for (int i = 0; i < count; ++i)
+			func(block);
+		filled = 0;
+	}
+};
+
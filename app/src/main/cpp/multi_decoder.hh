@@ -0,0 +1,101 @@
+/*
+Lock-step decoding of several streams with one stream per SIMD lane
+
+Copyright 2022 Ahmet Inan <inan@aicodix.de>
+*/
+
+#pragma once
+
+#include <new>
+#include "decoder.hh"
+
+// as many streams as the widest float vector holds
+#ifdef __AVX2__
+static const int multi_lanes = 8;
+#else
+static const int multi_lanes = 4;
+#endif
+
+struct MultiDecoderInterface {
+	virtual bool feed(const int16_t *, int, int) = 0;
+
+	virtual DecoderInterface *lane(int) = 0;
+
+	virtual void reset() = 0;
+
+	virtual ~MultiDecoderInterface() = default;
+};
+
+template<int RATE, int STREAMS>
+class MultiDecoder : public MultiDecoderInterface {
+	typedef DSP::Complex<float> cmplx;
+	typedef SIMD<float, STREAMS> float_simd;
+	static const int symbol_length = (1280 * RATE) / 8000;
+	static const int guard_length = symbol_length / 8;
+	static const int extended_length = symbol_length + guard_length;
+	static const int filter_length = (((33 * RATE) / 8000) & ~3) | 1;
+	static const int buffer_length = 4 * extended_length;
+	static const int search_position = extended_length;
+	static const int peak_count = 8;
+	DSP::FrontEndLanes<STREAMS, filter_length> front_end;
+	SchmidlCoxLanes<float, cmplx, STREAMS, search_position, symbol_length / 2, guard_length, buffer_length> correlator;
+	Decoder<RATE> decoders[STREAMS];
+	cmplx temp[STREAMS][extended_length];
+	SyncPeak peaks[STREAMS][peak_count];
+	int peak_size[STREAMS];
+
+public:
+	Decoder<RATE> &operator[](int stream) {
+		return decoders[stream];
+	}
+
+	DecoderInterface *lane(int stream) final {
+		return decoders + stream;
+	}
+
+	void reset() final {
+		front_end.reset();
+		correlator.reset();
+		for (Decoder<RATE> &decoder: decoders)
+			decoder.reset();
+	}
+
+	// samples of all streams interleaved, only the streams in the lane mask reach their Decoder
+	bool feed(const int16_t *samples, int sample_count, int lane_mask) final {
+		assert(sample_count <= extended_length);
+		for (int k = 0; k < STREAMS; ++k)
+			peak_size[k] = 0;
+		for (int i = 0; i < sample_count; ++i) {
+			float_simd re, im;
+			front_end(&re, &im, samples + STREAMS * i);
+			for (int k = 0; k < STREAMS; ++k)
+				temp[k][i] = cmplx(re.v[k], im.v[k]);
+			int found = correlator(re, im);
+			for (int k = 0; found; ++k, found >>= 1)
+				if ((found & 1) && peak_size[k] < peak_count)
+					peaks[k][peak_size[k]++] = {i, correlator.index[k], correlator.phase[k]};
+		}
+		bool ready = false;
+		for (int k = 0; k < STREAMS; ++k)
+			if (lane_mask & (1 << k))
+				ready = decoders[k].feed(temp[k], sample_count, peaks[k], peak_size[k]);
+		return ready;
+	}
+};
+
+
+static MultiDecoderInterface *create_multi_decoder(int rate) {
+	switch (rate) {
+		case 8000:
+			return new(std::nothrow) MultiDecoder<8000, multi_lanes>();
+		case 16000:
+			return new(std::nothrow) MultiDecoder<16000, multi_lanes>();
+		case 32000:
+			return new(std::nothrow) MultiDecoder<32000, multi_lanes>();
+		case 44100:
+			return new(std::nothrow) MultiDecoder<44100, multi_lanes>();
+		case 48000:
+			return new(std::nothrow) MultiDecoder<48000, multi_lanes>();
+	}
+	return nullptr;
+}
@@ -9,36 +9,45 @@ Copyright 2022 Ahmet Inan <inan@aicodix.de>
 #include "encoder.hh"
 #include "decoder.hh"
 
-static EncoderInterface *encoder;
-static DecoderInterface *decoder;
+static EncoderInterface *encoder, *encoders[5];
+static DecoderInterface *decoder, *decoders[10];
 
 extern "C" JNIEXPORT jboolean JNICALL
 Java_com_aicodix_rattlegram_MainActivity_createEncoder(
 	JNIEnv *,
 	jobject,
 	jint sampleRate) {
-	if (encoder && encoder->rate() == sampleRate)
-		return true;
-	delete encoder;
 	switch (sampleRate) {
 		case 8000:
-			encoder = new(std::nothrow) Encoder<8000>();
+			if (!encoders[0])
+				encoders[0] = new(std::nothrow) Encoder<8000>();
+			encoder = encoders[0];
 			break;
 		case 16000:
-			encoder = new(std::nothrow) Encoder<16000>();
+			if (!encoders[1])
+				encoders[1] = new(std::nothrow) Encoder<16000>();
+			encoder = encoders[1];
 			break;
 		case 32000:
-			encoder = new(std::nothrow) Encoder<32000>();
+			if (!encoders[2])
+				encoders[2] = new(std::nothrow) Encoder<32000>();
+			encoder = encoders[2];
 			break;
 		case 44100:
-			encoder = new(std::nothrow) Encoder<44100>();
+			if (!encoders[3])
+				encoders[3] = new(std::nothrow) Encoder<44100>();
+			encoder = encoders[3];
 			break;
 		case 48000:
-			encoder = new(std::nothrow) Encoder<48000>();
+			if (!encoders[4])
+				encoders[4] = new(std::nothrow) Encoder<48000>();
+			encoder = encoders[4];
 			break;
 		default:
 			encoder = nullptr;
 	}
+	if (encoder)
+		encoder->reset();
 	return encoder != nullptr;
 }
 
@@ -46,7 +55,10 @@ extern "C" JNIEXPORT void JNICALL
 Java_com_aicodix_rattlegram_MainActivity_destroyEncoder(
 	JNIEnv *,
 	jobject) {
-	delete encoder;
+	for (auto &pooled: encoders) {
+		delete pooled;
+		pooled = nullptr;
+	}
 	encoder = nullptr;
 }
 
@@ -76,7 +88,8 @@ Java_com_aicodix_rattlegram_MainActivity_configureEncoder(
 	jbyteArray JNI_callSign,
 	jint carrierFrequency,
 	jint noiseSymbols,
-	jboolean fancyHeader) {
+	jboolean fancyHeader,
+	jint paprIterations) {
 
 	if (!encoder)
 		return;
@@ -94,7 +107,8 @@ Java_com_aicodix_rattlegram_MainActivity_configureEncoder(
 		reinterpret_cast<int8_t *>(callSign),
 		carrierFrequency,
 		noiseSymbols,
-		fancyHeader);
+		fancyHeader,
+		paprIterations);
 
 	env->ReleaseByteArrayElements(JNI_callSign, callSign, JNI_ABORT);
 	callSignFail:
@@ -102,11 +116,48 @@ Java_com_aicodix_rattlegram_MainActivity_configureEncoder(
 	payloadFail:;
 }
 
+extern "C" JNIEXPORT jboolean JNICALL
+Java_com_aicodix_rattlegram_MainActivity_paprEncoder(
+	JNIEnv *env,
+	jobject,
+	jfloatArray JNI_ratio,
+	jlongArray JNI_nanoseconds) {
+
+	jboolean status = false;
+
+	if (!encoder || env->GetArrayLength(JNI_ratio) < 1 || env->GetArrayLength(JNI_nanoseconds) < 1)
+		return status;
+
+	jfloat *ratio;
+	jlong *nanoseconds;
+	ratio = env->GetFloatArrayElements(JNI_ratio, nullptr);
+	if (!ratio)
+		goto ratioFail;
+	nanoseconds = env->GetLongArrayElements(JNI_nanoseconds, nullptr);
+	if (!nanoseconds)
+		goto nanosecondsFail;
+
+	encoder->papr(
+		reinterpret_cast<float *>(ratio),
+		reinterpret_cast<int64_t *>(nanoseconds));
+	status = true;
+
+	env->ReleaseLongArrayElements(JNI_nanoseconds, nanoseconds, 0);
+	nanosecondsFail:
+	env->ReleaseFloatArrayElements(JNI_ratio, ratio, 0);
+	ratioFail:
+
+	return status;
+}
+
 extern "C" JNIEXPORT void JNICALL
 Java_com_aicodix_rattlegram_MainActivity_destroyDecoder(
 	JNIEnv *,
 	jobject) {
-	delete decoder;
+	for (auto &pooled: decoders) {
+		delete pooled;
+		pooled = nullptr;
+	}
 	decoder = nullptr;
 }
 
@@ -114,29 +165,37 @@ extern "C" JNIEXPORT jboolean JNICALL
 Java_com_aicodix_rattlegram_MainActivity_createDecoder(
 	JNIEnv *,
 	jobject,
-	jint sampleRate) {
-	if (decoder && decoder->rate() == sampleRate)
-		return true;
-	delete decoder;
+	jint sampleRate,
+	jboolean fixedPoint) {
+	int index;
 	switch (sampleRate) {
 		case 8000:
-			decoder = new(std::nothrow) Decoder<8000>();
+			index = 0;
 			break;
 		case 16000:
-			decoder = new(std::nothrow) Decoder<16000>();
+			index = 1;
 			break;
 		case 32000:
-			decoder = new(std::nothrow) Decoder<32000>();
+			index = 2;
 			break;
 		case 44100:
-			decoder = new(std::nothrow) Decoder<44100>();
+			index = 3;
 			break;
 		case 48000:
-			decoder = new(std::nothrow) Decoder<48000>();
+			index = 4;
 			break;
 		default:
 			decoder = nullptr;
+			return false;
 	}
+	// the fixed point front end decoders are pooled behind the float ones
+	if (fixedPoint)
+		index += 5;
+	if (!decoders[index])
+		decoders[index] = create_decoder(sampleRate, fixedPoint);
+	decoder = decoders[index];
+	if (decoder)
+		decoder->reset();
 	return decoder != nullptr;
 }
 
@@ -261,3 +320,141 @@ Java_com_aicodix_rattlegram_MainActivity_spectrumDecoder(
 	spectrumFail:;
 }
 
+extern "C" JNIEXPORT jboolean JNICALL
+Java_com_aicodix_rattlegram_MainActivity_timingDecoder(
+	JNIEnv *env,
+	jobject,
+	jlongArray JNI_stats,
+	jboolean reset) {
+
+	jboolean status = false;
+
+	if (!decoder || env->GetArrayLength(JNI_stats) < 3 * TIMING_COUNT)
+		return status;
+
+	jlong *stats;
+	stats = env->GetLongArrayElements(JNI_stats, nullptr);
+	if (!stats)
+		goto statsFail;
+
+	decoder->timing(reinterpret_cast<int64_t *>(stats), reset);
+	status = true;
+
+	env->ReleaseLongArrayElements(JNI_stats, stats, 0);
+	statsFail:
+
+	return status;
+}
+
+extern "C" JNIEXPORT jboolean JNICALL
+Java_com_aicodix_rattlegram_MainActivity_metricsDecoder(
+	JNIEnv *env,
+	jobject,
+	jintArray JNI_eventCounts,
+	jfloatArray JNI_frameQuality,
+	jfloatArray JNI_carrierSnr,
+	jboolean reset) {
+
+	jboolean status = false;
+
+	if (!decoder
+		|| env->GetArrayLength(JNI_eventCounts) < EVENT_COUNT
+		|| env->GetArrayLength(JNI_frameQuality) < QUALITY_COUNT
+		|| env->GetArrayLength(JNI_carrierSnr) < 256)
+		return status;
+
+	jint *eventCounts;
+	jfloat *frameQuality, *carrierSnr;
+	eventCounts = env->GetIntArrayElements(JNI_eventCounts, nullptr);
+	if (!eventCounts)
+		goto eventCountsFail;
+	frameQuality = env->GetFloatArrayElements(JNI_frameQuality, nullptr);
+	if (!frameQuality)
+		goto frameQualityFail;
+	carrierSnr = env->GetFloatArrayElements(JNI_carrierSnr, nullptr);
+	if (!carrierSnr)
+		goto carrierSnrFail;
+
+	decoder->metrics(
+		reinterpret_cast<int32_t *>(eventCounts),
+		reinterpret_cast<float *>(frameQuality),
+		reinterpret_cast<float *>(carrierSnr),
+		reset);
+	status = true;
+
+	env->ReleaseFloatArrayElements(JNI_carrierSnr, carrierSnr, 0);
+	carrierSnrFail:
+	env->ReleaseFloatArrayElements(JNI_frameQuality, frameQuality, 0);
+	frameQualityFail:
+	env->ReleaseIntArrayElements(JNI_eventCounts, eventCounts, 0);
+	eventCountsFail:
+
+	return status;
+}
+
+extern "C" JNIEXPORT jboolean JNICALL
+Java_com_aicodix_rattlegram_MainActivity_flushTrace(
+	JNIEnv *env,
+	jobject,
+	jstring JNI_path) {
+
+	jboolean status = false;
+
+#ifdef ENABLE_TRACING
+	const char *path;
+	path = env->GetStringUTFChars(JNI_path, nullptr);
+	if (!path)
+		goto pathFail;
+
+	status = Trace::flush(path);
+
+	env->ReleaseStringUTFChars(JNI_path, path);
+	pathFail:
+#else
+	(void) env;
+	(void) JNI_path;
+#endif
+
+	return status;
+}
+
+extern "C" JNIEXPORT jboolean JNICALL
+Java_com_aicodix_rattlegram_MainActivity_captureDecoder(
+	JNIEnv *env,
+	jobject,
+	jstring JNI_directory,
+	jint triggers) {
+
+	jboolean status = false;
+
+	if (!decoder)
+		return status;
+
+	if (!JNI_directory)
+		return decoder->capture(nullptr, 0);
+
+	const char *directory;
+	directory = env->GetStringUTFChars(JNI_directory, nullptr);
+	if (!directory)
+		goto directoryFail;
+
+	status = decoder->capture(directory, triggers);
+
+	env->ReleaseStringUTFChars(JNI_directory, directory);
+	directoryFail:
+
+	return status;
+}
+
+extern "C" JNIEXPORT jboolean JNICALL
+Java_com_aicodix_rattlegram_MainActivity_hypothesesDecoder(
+	JNIEnv *,
+	jobject,
+	jint threads) {
+
+	if (!decoder)
+		return false;
+
+	return decoder->hypotheses(threads);
+}
+
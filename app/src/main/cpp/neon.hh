@@ -451,6 +451,22 @@ inline SIMD<float, 4> vmul(SIMD<float, 4> a, SIMD<float, 4> b)
 	return tmp;
 }
 
+template <>
+inline SIMD<float, 4> vdiv(SIMD<float, 4> a, SIMD<float, 4> b)
+{
+	SIMD<float, 4> tmp;
+#ifdef __aarch64__
+	tmp.m = vdivq_f32(a.m, b.m);
+#else
+	// two Newton-Raphson steps on the 8 bit estimate stay within 3 ulp of a / b, not correctly rounded
+	float32x4_t r = vrecpeq_f32(b.m);
+	r = vmulq_f32(vrecpsq_f32(b.m, r), r);
+	r = vmulq_f32(vrecpsq_f32(b.m, r), r);
+	tmp.m = vmulq_f32(a.m, r);
+#endif
+	return tmp;
+}
+
 template <>
 inline SIMD<int8_t, 16> vmul(SIMD<int8_t, 16> a, SIMD<int8_t, 16> b)
 {
@@ -978,3 +994,37 @@ inline SIMD<int8_t, 16> vshuf(SIMD<int8_t, 16> a, SIMD<uint8_t, 16> b)
 	return tmp;
 }
 
+template <>
+inline SIMD<int32_t, 4> vcvtn(SIMD<float, 4> a)
+{
+	SIMD<int32_t, 4> tmp;
+#ifdef __aarch64__
+	tmp.m = vcvtnq_s32_f32(a.m);
+#else
+	// armv7 only truncates, so step away from zero past the half and on ties to odd, like nearbyint
+	int32x4_t t = vcvtq_s32_f32(a.m);
+	float32x4_t f = vsubq_f32(a.m, vcvtq_f32_s32(t));
+	uint32x4_t tie = vandq_u32(vceqq_f32(vabsq_f32(f), vdupq_n_f32(0.5f)), vtstq_s32(t, vdupq_n_s32(1)));
+	uint32x4_t away = vorrq_u32(vcagtq_f32(f, vdupq_n_f32(0.5f)), tie);
+	int32x4_t step = vorrq_s32(vshrq_n_s32(vreinterpretq_s32_f32(f), 31), vdupq_n_s32(1));
+	tmp.m = vqaddq_s32(t, vandq_s32(step, vreinterpretq_s32_u32(away)));
+#endif
+	return tmp;
+}
+
+template <>
+inline SIMD<float, 4> vcvt(SIMD<int32_t, 4> a)
+{
+	SIMD<float, 4> tmp;
+	tmp.m = vcvtq_f32_s32(a.m);
+	return tmp;
+}
+
+template <>
+inline SIMD<int16_t, 8> vqmovn(SIMD<int32_t, 4> a, SIMD<int32_t, 4> b)
+{
+	SIMD<int16_t, 8> tmp;
+	tmp.m = vcombine_s16(vqmovn_s32(a.m), vqmovn_s32(b.m));
+	return tmp;
+}
+
@@ -6,41 +6,73 @@ Copyright 2021 Ahmet Inan <inan@aicodix.de>
 
 #pragma once
 
+#include "unit_circle.hh"
 #include "fft.hh"
 
+// oversampled signal computed as fact polyphase components of size points each
+// returns the peak-to-average power ratio seen by the last clipping pass
+
 template<typename cmplx, int size, int fact>
 struct ImprovePAPR {
 	typedef typename cmplx::value_type value;
-	DSP::FastFourierTransform<fact * size, cmplx, -1> fwd;
-	DSP::FastFourierTransform<fact * size, cmplx, 1> bwd;
-	cmplx temp[fact * size], over[fact * size];
+	DSP::FastFourierTransform<size, cmplx, -1> fwd;
+	DSP::FastFourierTransform<size, cmplx, 1> bwd;
+	struct Shift {
+		cmplx z[fact * size];
+
+		Shift() {
+			for (int r = 0; r < fact; ++r) {
+				for (int i = 0; i < size; ++i) {
+					int k = i < size / 2 ? i : i - size;
+					z[size * r + i] = cmplx(
+						DSP::UnitCircle<value>::cos(k * r, fact * size),
+						DSP::UnitCircle<value>::sin(k * r, fact * size));
+				}
+			}
+		}
+	};
+	cmplx temp[size], over[fact * size];
+	const cmplx *shift;
 	bool used[size];
 
-	void operator()(cmplx *freq) {
+	static const cmplx *shared_shift() {
+		static const Shift table;
+		return table.z;
+	}
+
+	ImprovePAPR() : shift(shared_shift()) {}
+
+	value operator()(cmplx *freq, int iterations = 1) {
 		for (int i = 0; i < size; ++i)
 			used[i] = freq[i].real() || freq[i].imag();
-		for (int i = 0; i < size / 2; ++i)
-			over[i] = freq[i];
-		for (int i = size / 2; i < fact * size - size / 2; ++i)
-			over[i] = 0;
-		for (int i = size / 2; i < size; ++i)
-			over[size * (fact - 1) + i] = freq[i];
-		bwd(temp, over);
 		value factor = 1 / std::sqrt(value(fact * size));
-		for (int i = 0; i < fact * size; ++i)
-			temp[i] *= factor;
-		for (int i = 0; i < fact * size; ++i) {
-			value pwr = norm(temp[i]);
-			if (pwr > 1)
-				temp[i] /= std::sqrt(pwr);
+		value papr = 0;
+		for (int iter = 0; iter < iterations; ++iter) {
+			for (int r = 0; r < fact; ++r) {
+				for (int i = 0; i < size; ++i)
+					temp[i] = factor * freq[i] * shift[size * r + i];
+				bwd(over + size * r, temp);
+			}
+			value peak = 0, mean = 0;
+			for (int i = 0; i < fact * size; ++i) {
+				value pwr = norm(over[i]);
+				peak = std::max(peak, pwr);
+				mean += pwr;
+				if (pwr > 1)
+					over[i] /= std::sqrt(pwr);
+			}
+			papr = mean > 0 ? fact * size * peak / mean : 0;
+			for (int i = 0; i < size; ++i)
+				if (used[i])
+					freq[i] = 0;
+			for (int r = 0; r < fact; ++r) {
+				fwd(temp, over + size * r);
+				for (int i = 0; i < size; ++i)
+					if (used[i])
+						freq[i] += factor * temp[i] * conj(shift[size * r + i]);
+			}
 		}
-		fwd(over, temp);
-		for (int i = 0; i < size / 2; ++i)
-			if (used[i])
-				freq[i] = factor * over[i];
-		for (int i = size / 2; i < size; ++i)
-			if (used[i])
-				freq[i] = factor * over[size * (fact - 1) + i];
+		return papr;
 	}
 };
 
@@ -52,23 +84,31 @@ struct ImprovePAPR<cmplx, size, 1> {
 	cmplx temp[size];
 	bool used[size];
 
-	void operator()(cmplx *freq) {
+	value operator()(cmplx *freq, int iterations = 1) {
 		for (int i = 0; i < size; ++i)
 			used[i] = freq[i].real() || freq[i].imag();
-		bwd(temp, freq);
 		value factor = 1 / std::sqrt(value(size));
-		for (int i = 0; i < size; ++i)
-			temp[i] *= factor;
-		for (int i = 0; i < size; ++i) {
-			value pwr = norm(temp[i]);
-			if (pwr > 1)
-				temp[i] /= std::sqrt(pwr);
+		value papr = 0;
+		for (int iter = 0; iter < iterations; ++iter) {
+			bwd(temp, freq);
+			for (int i = 0; i < size; ++i)
+				temp[i] *= factor;
+			value peak = 0, mean = 0;
+			for (int i = 0; i < size; ++i) {
+				value pwr = norm(temp[i]);
+				peak = std::max(peak, pwr);
+				mean += pwr;
+				if (pwr > 1)
+					temp[i] /= std::sqrt(pwr);
+			}
+			papr = mean > 0 ? size * peak / mean : 0;
+			fwd(freq, temp);
+			for (int i = 0; i < size; ++i)
+				if (used[i])
+					freq[i] *= factor;
+				else
+					freq[i] = 0;
 		}
-		fwd(freq, temp);
-		for (int i = 0; i < size; ++i)
-			if (used[i])
-				freq[i] *= factor;
-			else
-				freq[i] = 0;
+		return papr;
 	}
 };
@@ -15,30 +15,31 @@ Copyright 2022 Ahmet Inan <inan@aicodix.de>
 #include "polar_helper.hh"
 #include "polar_encoder.hh"
 #include "polar_list_decoder.hh"
+#include "polar_batch_decoder.hh"
 
-template<typename code_type>
 class PolarEncoder {
 	static const int code_order = 11;
 	static const int max_bits = 1360 + 32;
 	CODE::CRC<uint32_t> crc;
-	CODE::PolarSysEnc<code_type> encode;
-	int8_t mesg[max_bits];
-
-	static int nrz(bool bit) {
-		return 1 - 2 * bit;
-	}
+	CODE::PolarPackedSysEnc encode;
+	uint64_t mesg[max_bits / 64 + 1];
 
 public:
 	PolarEncoder() : crc(0x8F6E37A0) {}
 
-	void operator()(code_type *code, const uint8_t *message, const uint32_t *frozen_bits, int data_bits) {
-		for (int i = 0; i < data_bits; ++i)
-			mesg[i] = nrz(CODE::get_le_bit(message, i));
+	// codeword is bit packed, least significant bit first
+	void operator()(uint64_t *code, const uint8_t *message, const uint32_t *frozen_bits, int data_bits) {
+		for (int i = 0; i < max_bits / 64 + 1; ++i)
+			mesg[i] = 0;
 		crc.reset();
-		for (int i = 0; i < data_bits / 8; ++i)
+		for (int i = 0; i < data_bits / 8; ++i) {
+			mesg[i / 8] |= uint64_t(message[i]) << (8 * (i % 8));
 			crc(message[i]);
-		for (int i = 0; i < 32; ++i)
-			mesg[i + data_bits] = nrz((crc() >> i) & 1);
+		}
+		uint64_t sum = crc();
+		mesg[data_bits / 64] |= sum << (data_bits % 64);
+		if (data_bits % 64 > 32)
+			mesg[data_bits / 64 + 1] |= sum >> (64 - data_bits % 64);
 		encode(code, mesg, frozen_bits, code_order);
 	}
 };
@@ -53,30 +54,41 @@ class PolarDecoder {
 	static const int code_order = 11;
 	static const int code_len = 1 << code_order;
 	static const int max_bits = 1360 + 32;
+	typedef CODE::PolarPackedHelper PPH;
 	CODE::CRC<uint32_t> crc;
-	CODE::PolarEncoder<mesg_type> encode;
+	CODE::PolarPackedEncoder encode;
 	CODE::PolarListDecoder<mesg_type, code_order> decode;
-	mesg_type mesg[max_bits], mess[code_len];
+	mesg_type mesg[max_bits];
+	uint64_t data[max_bits / 64 + 1], mess[code_len / 64];
 
-	void systematic(const uint32_t *frozen_bits, int crc_bits) {
-		encode(mess, mesg, frozen_bits, code_order);
-		for (int i = 0, j = 0; i < code_len && j < crc_bits; ++i)
-			if (!((frozen_bits[i / 32] >> (i % 32)) & 1))
-				mesg[j++] = mess[i];
+	void systematic(int path, const uint32_t *frozen_bits, int crc_bits) {
+		for (int i = 0; i < max_bits / 64 + 1; ++i)
+			data[i] = 0;
+		for (int i = 0; i < crc_bits; ++i)
+			data[i / 64] |= uint64_t(mesg[i].v[path] < 0) << (i % 64);
+		encode(mess, data, frozen_bits, code_order);
+		for (int i = 0, j = 0; i < code_len && j < crc_bits; ++i, ++j) {
+			while (PPH::get(frozen_bits, i))
+				++i;
+			data[j / 64] = (data[j / 64] & ~(uint64_t(1) << (j % 64))) | uint64_t(PPH::get(mess, i)) << (j % 64);
+		}
 	}
 
 public:
+	int path = -1;
+
 	PolarDecoder() : crc(0x8F6E37A0) {}
 
 	int operator()(uint8_t *message, const code_type *code, const uint32_t *frozen_bits, int data_bits) {
 		int crc_bits = data_bits + 32;
 		decode(nullptr, mesg, code, frozen_bits, code_order);
-		systematic(frozen_bits, crc_bits);
 		int best = -1;
+		path = -1;
 		for (int k = 0; k < mesg_type::SIZE; ++k) {
+			systematic(k, frozen_bits, crc_bits);
 			crc.reset();
 			for (int i = 0; i < crc_bits; ++i)
-				crc(mesg[i].v[k] < 0);
+				crc(PPH::get(data, i));
 			if (crc() == 0) {
 				best = k;
 				break;
@@ -84,15 +96,99 @@ public:
 		}
 		if (best < 0)
 			return -1;
+		path = best;
 		int flips = 0;
 		for (int i = 0, j = 0; i < data_bits; ++i, ++j) {
 			while ((frozen_bits[j / 32] >> (j % 32)) & 1)
 				++j;
 			bool received = code[j] < 0;
-			bool decoded = mesg[i].v[best] < 0;
+			bool decoded = PPH::get(data, i);
 			flips += received != decoded;
 			CODE::set_le_bit(message, i, decoded);
 		}
 		return flips;
 	}
 };
+
+template<typename code_type, int GROUPS>
+class BatchPolarDecoder {
+#ifdef __AVX2__
+	typedef SIMD<code_type, 32 / sizeof(code_type)> mesg_type;
+#else
+	typedef SIMD<code_type, 16 / sizeof(code_type)> mesg_type;
+#endif
+	static const int code_order = 11;
+	static const int code_len = 1 << code_order;
+	static const int max_bits = 1360 + 32;
+	static const int lanes = mesg_type::SIZE / GROUPS;
+	typedef CODE::PolarPackedHelper PPH;
+	CODE::CRC<uint32_t> crc;
+	CODE::PolarBatchDecoder<mesg_type, code_order, GROUPS> decode;
+	mesg_type mesg[code_len];
+	uint64_t data[max_bits / 64 + 1], mess[code_len / 64];
+	int position[max_bits], entry[max_bits];
+
+	void index(int group, const uint32_t *const *frozen_bits, int crc_bits) {
+		for (int i = 0, j = 0, k = 0; i < code_len && j < crc_bits; ++i) {
+			bool common = true;
+			for (int g = 0; g < GROUPS; ++g)
+				common &= PPH::get(frozen_bits[g], i);
+			if (common)
+				continue;
+			if (!PPH::get(frozen_bits[group], i)) {
+				position[j] = i;
+				entry[j++] = k;
+			}
+			++k;
+		}
+	}
+
+	void systematic(int lane, int crc_bits) {
+		for (int i = 0; i < code_len / 64; ++i)
+			mess[i] = 0;
+		for (int j = 0; j < crc_bits; ++j)
+			mess[position[j] / 64] |= uint64_t(mesg[entry[j]].v[lane] < 0) << (position[j] % 64);
+		PPH::transform(mess, code_len);
+		for (int i = 0; i < max_bits / 64 + 1; ++i)
+			data[i] = 0;
+		for (int j = 0; j < crc_bits; ++j)
+			data[j / 64] |= uint64_t(PPH::get(mess, position[j])) << (j % 64);
+	}
+
+public:
+	int path[GROUPS];
+
+	BatchPolarDecoder() : crc(0x8F6E37A0) {}
+
+	// decodes GROUPS codewords with lanes/GROUPS list paths each, result is flips or -1 per codeword
+	void operator()(int *result, uint8_t *const *message, const code_type *const *code, const uint32_t *const *frozen_bits, const int *data_bits) {
+		decode(nullptr, mesg, code, frozen_bits, code_order);
+		for (int g = 0; g < GROUPS; ++g) {
+			int crc_bits = data_bits[g] + 32;
+			index(g, frozen_bits, crc_bits);
+			result[g] = -1;
+			path[g] = -1;
+			for (int k = 0; k < lanes; ++k) {
+				systematic(g * lanes + k, crc_bits);
+				crc.reset();
+				for (int i = 0; i < crc_bits; ++i)
+					crc(PPH::get(data, i));
+				if (crc() == 0) {
+					path[g] = k;
+					break;
+				}
+			}
+			if (path[g] < 0)
+				continue;
+			int flips = 0;
+			for (int i = 0; i < data_bits[g]; ++i) {
+				bool received = code[g][position[i]] < 0;
+				bool decoded = PPH::get(data, i);
+				flips += received != decoded;
+				CODE::set_le_bit(message[g], i, decoded);
+			}
+			result[g] = flips;
+		}
+	}
+};
+
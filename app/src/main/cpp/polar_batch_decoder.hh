@@ -0,0 +1,174 @@
+/*
+Successive cancellation list decoding of several polar codewords at once
+
+Copyright 2022 Ahmet Inan <inan@aicodix.de>
+*/
+
+#pragma once
+
+#include "sort.hh"
+#include "polar_helper.hh"
+#include "polar_list_decoder.hh"
+
+namespace CODE {
+
+template <typename TYPE, int M, int GROUPS>
+struct PolarBatchTree
+{
+	typedef PolarHelper<TYPE> PH;
+	typedef typename PH::PATH PATH;
+	typedef typename PH::MAP MAP;
+	static const int N = 1 << M;
+	static bool rate0(const uint32_t *frozen, int pos)
+	{
+		if (N/2 < 32) {
+			uint32_t mask = ~(~0U << (N/2 % 32)) << (pos % 32);
+			return (frozen[pos/32] & mask) == mask;
+		}
+		for (int i = pos/32; i < (pos+N/2)/32; ++i)
+			if (frozen[i] != 0xffffffff)
+				return false;
+		return true;
+	}
+	static MAP decode(PATH *metric, TYPE *message, MAP *maps, int *count, TYPE *hard, TYPE *soft, const uint32_t *frozen, const uint32_t *groups, int pos)
+	{
+		for (int i = 0; i < N/2; ++i)
+			soft[i+N/2] = PH::prod(soft[i+N], soft[i+N/2+N]);
+		MAP lmap, rmap;
+		if (rate0(frozen, pos))
+			lmap = PolarListNode<TYPE, M-1>::rate0(metric, hard, soft);
+		else
+			lmap = PolarBatchTree<TYPE, M-1, GROUPS>::decode(metric, message, maps, count, hard, soft, frozen, groups, pos);
+		for (int i = 0; i < N/2; ++i)
+			soft[i+N/2] = PH::madd(hard[i], vshuf(soft[i+N], lmap), vshuf(soft[i+N/2+N], lmap));
+		if (rate0(frozen, pos+N/2))
+			rmap = PolarListNode<TYPE, M-1>::rate0(metric, hard+N/2, soft);
+		else
+			rmap = PolarBatchTree<TYPE, M-1, GROUPS>::decode(metric, message, maps, count, hard+N/2, soft, frozen, groups, pos+N/2);
+		for (int i = 0; i < N/2; ++i)
+			hard[i] = PH::qmul(vshuf(hard[i], rmap), hard[i+N/2]);
+		return vshuf(lmap, rmap);
+	}
+};
+
+template <typename TYPE, int GROUPS>
+struct PolarBatchTree<TYPE, 0, GROUPS>
+{
+	typedef PolarHelper<TYPE> PH;
+	typedef typename PH::PATH PATH;
+	typedef typename PH::MAP MAP;
+	static const int L = TYPE::SIZE / GROUPS;
+	static MAP decode(PATH *metric, TYPE *message, MAP *maps, int *count, TYPE *hard, TYPE *soft, const uint32_t *, const uint32_t *groups, int pos)
+	{
+		TYPE sft = soft[1], hrd;
+		MAP map;
+		for (int g = 0, o = 0; g < GROUPS; ++g, o += L) {
+			if ((groups[pos] >> g) & 1) {
+				for (int k = o; k < o + L; ++k) {
+					if (sft.v[k] < 0)
+						metric[k] -= sft.v[k];
+					map.v[k] = k;
+					hrd.v[k] = 1;
+				}
+				continue;
+			}
+			PATH fork[2*L];
+			for (int k = 0; k < L; ++k)
+				fork[2*k] = fork[2*k+1] = metric[o+k];
+			for (int k = 0; k < L; ++k)
+				if (sft.v[o+k] < 0)
+					fork[2*k] -= sft.v[o+k];
+				else
+					fork[2*k+1] += sft.v[o+k];
+			int perm[2*L];
+			CODE::insertion_sort(perm, fork, 2*L);
+			for (int k = 0; k < L; ++k) {
+				metric[o+k] = fork[k];
+				map.v[o+k] = o + (perm[k] >> 1);
+				hrd.v[o+k] = 1 - 2 * (perm[k] & 1);
+			}
+		}
+		message[*count] = hrd;
+		maps[*count] = map;
+		++*count;
+		*hard = hrd;
+		return map;
+	}
+};
+
+// lanes are split into GROUPS lists of TYPE::SIZE/GROUPS paths, one per codeword
+template <typename TYPE, int MAX_M, int GROUPS>
+class PolarBatchDecoder
+{
+	static_assert(MAX_M >= 5 && MAX_M <= 16);
+	static_assert(GROUPS >= 1 && GROUPS <= 32 && TYPE::SIZE % GROUPS == 0);
+	typedef PolarHelper<TYPE> PH;
+	typedef typename TYPE::value_type VALUE;
+	typedef typename PH::PATH PATH;
+	typedef typename PH::MAP MAP;
+	static const int MAX_N = 1 << MAX_M;
+	static const int LANES = TYPE::SIZE / GROUPS;
+	TYPE soft[2*MAX_N];
+	TYPE hard[MAX_N];
+	MAP maps[MAX_N];
+	uint32_t common[MAX_N/32];
+	uint32_t groups[MAX_N];
+public:
+	// message gets one entry for every bit not frozen in all of the groups
+	int operator()(int *rank, TYPE *message, const VALUE *const *codewords, const uint32_t *const *frozen, int level)
+	{
+		assert(level >= 5 && level <= MAX_M);
+		int length = 1 << level;
+		for (int i = 0; i < length / 32; ++i) {
+			common[i] = 0xffffffff;
+			for (int g = 0; g < GROUPS; ++g)
+				common[i] &= frozen[g][i];
+		}
+		for (int i = 0; i < length; ++i) {
+			groups[i] = 0;
+			for (int g = 0; g < GROUPS; ++g)
+				groups[i] |= ((frozen[g][i/32] >> (i%32)) & 1) << g;
+		}
+		PATH metric[TYPE::SIZE];
+		for (int k = 0; k < TYPE::SIZE; ++k)
+			metric[k] = k % LANES ? 1000000 : 0;
+		for (int i = 0; i < length; ++i)
+			for (int g = 0; g < GROUPS; ++g)
+				for (int k = 0; k < LANES; ++k)
+					soft[length+i].v[g*LANES+k] = codewords[g][i];
+		int count = 0;
+
+		switch (level) {
+		case 5: PolarBatchTree<TYPE, 5, GROUPS>::decode(metric, message, maps, &count, hard, soft, common, groups, 0); break;
+		case 6: PolarBatchTree<TYPE, 6, GROUPS>::decode(metric, message, maps, &count, hard, soft, common, groups, 0); break;
+		case 7: PolarBatchTree<TYPE, 7, GROUPS>::decode(metric, message, maps, &count, hard, soft, common, groups, 0); break;
+		case 8: PolarBatchTree<TYPE, 8, GROUPS>::decode(metric, message, maps, &count, hard, soft, common, groups, 0); break;
+		case 9: PolarBatchTree<TYPE, 9, GROUPS>::decode(metric, message, maps, &count, hard, soft, common, groups, 0); break;
+		case 10: PolarBatchTree<TYPE, 10, GROUPS>::decode(metric, message, maps, &count, hard, soft, common, groups, 0); break;
+		case 11: PolarBatchTree<TYPE, 11, GROUPS>::decode(metric, message, maps, &count, hard, soft, common, groups, 0); break;
+		case 12: PolarBatchTree<TYPE, 12, GROUPS>::decode(metric, message, maps, &count, hard, soft, common, groups, 0); break;
+		case 13: PolarBatchTree<TYPE, 13, GROUPS>::decode(metric, message, maps, &count, hard, soft, common, groups, 0); break;
+		case 14: PolarBatchTree<TYPE, 14, GROUPS>::decode(metric, message, maps, &count, hard, soft, common, groups, 0); break;
+		case 15: PolarBatchTree<TYPE, 15, GROUPS>::decode(metric, message, maps, &count, hard, soft, common, groups, 0); break;
+		case 16: PolarBatchTree<TYPE, 16, GROUPS>::decode(metric, message, maps, &count, hard, soft, common, groups, 0); break;
+		default: assert(false);
+		}
+
+		for (int i = 0, r = 0; rank != nullptr && i < TYPE::SIZE; ++i) {
+			if (i % LANES == 0)
+				r = 0;
+			else if (metric[i-1] != metric[i])
+				++r;
+			rank[i] = r;
+		}
+		MAP acc = maps[count-1];
+		for (int i = count-2; i >= 0; --i) {
+			message[i] = vshuf(message[i], acc);
+			acc = vshuf(maps[i], acc);
+		}
+		return count;
+	}
+};
+
+}
+
@@ -70,5 +70,67 @@ public:
 	}
 };
 
+// bit packed variants, least significant bit first and set bits for ones, needs level >= 6
+struct PolarPackedHelper
+{
+	static bool get(const uint32_t *bits, int idx)
+	{
+		return (bits[idx/32] >> (idx%32)) & 1;
+	}
+	static bool get(const uint64_t *bits, int idx)
+	{
+		return (bits[idx/64] >> (idx%64)) & 1;
+	}
+	static void scatter(uint64_t *codeword, const uint64_t *message, const uint32_t *frozen, int length)
+	{
+		for (int i = 0; i < length / 64; ++i)
+			codeword[i] = 0;
+		for (int i = 0, j = 0; i < length; ++i)
+			if (!get(frozen, i))
+				codeword[i/64] |= uint64_t(get(message, j++)) << (i%64);
+	}
+	static void transform(uint64_t *codeword, int length)
+	{
+		static const uint64_t mask[6] = {
+			0x5555555555555555, 0x3333333333333333, 0x0f0f0f0f0f0f0f0f,
+			0x00ff00ff00ff00ff, 0x0000ffff0000ffff, 0x00000000ffffffff };
+		int words = length / 64;
+		for (int i = 0; i < words; ++i)
+			for (int h = 0; h < 6; ++h)
+				codeword[i] ^= (codeword[i] >> (1 << h)) & mask[h];
+		for (int h = 1; h < words; h *= 2)
+			for (int i = 0; i < words; i += 2 * h)
+				for (int j = i; j < i + h; ++j)
+					codeword[j] ^= codeword[j+h];
+	}
+};
+
+class PolarPackedEncoder
+{
+	typedef PolarPackedHelper PPH;
+public:
+	void operator()(uint64_t *codeword, const uint64_t *message, const uint32_t *frozen, int level)
+	{
+		int length = 1 << level;
+		PPH::scatter(codeword, message, frozen, length);
+		PPH::transform(codeword, length);
+	}
+};
+
+class PolarPackedSysEnc
+{
+	typedef PolarPackedHelper PPH;
+public:
+	void operator()(uint64_t *codeword, const uint64_t *message, const uint32_t *frozen, int level)
+	{
+		int length = 1 << level;
+		PPH::scatter(codeword, message, frozen, length);
+		PPH::transform(codeword, length);
+		for (int i = 0; i < length / 64; ++i)
+			codeword[i] &= ~(frozen[2*i] | uint64_t(frozen[2*i+1]) << 32);
+		PPH::transform(codeword, length);
+	}
+};
+
 }
 
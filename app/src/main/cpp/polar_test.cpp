@@ -0,0 +1,133 @@
+/*
+Equivalence of the batched polar list decoder with the single codeword decoder
+
+Copyright 2022 Ahmet Inan <inan@aicodix.de>
+*/
+
+#include <cassert>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <algorithm>
+#include "simd.hh"
+#include "xorshift.hh"
+#include "polar.hh"
+
+static const uint32_t *frozen[3] = {frozen_2048_712, frozen_2048_1056, frozen_2048_1392};
+static const int data_bits[3] = {680, 1024, 1360};
+
+static CODE::Xorshift32 prng;
+
+static float gauss() {
+	float u = (prng() + 1.f) / 4294967296.f;
+	float v = prng() / 4294967296.f;
+	return std::sqrt(-2.f * std::log(u)) * std::cos(6.28318530717958647692f * v);
+}
+
+struct Codeword {
+	int mode;
+	uint8_t message[170];
+	int8_t code[2048];
+};
+
+static void transmit(Codeword &codeword, float sigma) {
+	static PolarEncoder encode;
+	codeword.mode = prng() % 3;
+	for (int i = 0; i < data_bits[codeword.mode] / 8; ++i)
+		codeword.message[i] = prng();
+	uint64_t bits[2048 / 64];
+	encode(bits, codeword.message, frozen[codeword.mode], data_bits[codeword.mode]);
+	for (int i = 0; i < 2048; ++i) {
+		float symbol = 1 - 2 * int((bits[i / 64] >> (i % 64)) & 1);
+		codeword.code[i] = std::clamp(std::nearbyint(8 * (symbol + sigma * gauss())), -127.f, 127.f);
+	}
+}
+
+// one group keeps the whole list and must reproduce the single codeword decoder bit for bit
+static int single(int trials, float sigma) {
+	static PolarDecoder<int8_t> reference;
+	static BatchPolarDecoder<int8_t, 1> batch;
+	int failed = 0, decoded = 0;
+	for (int t = 0; t < trials; ++t) {
+		Codeword codeword;
+		transmit(codeword, sigma);
+		int bytes = data_bits[codeword.mode] / 8;
+		uint8_t expected[170] = {0}, message[170] = {0};
+		int flips = reference(expected, codeword.code, frozen[codeword.mode], data_bits[codeword.mode]);
+		uint8_t *messages[1] = {message};
+		const int8_t *codes[1] = {codeword.code};
+		const uint32_t *frozens[1] = {frozen[codeword.mode]};
+		int result[1];
+		batch(result, messages, codes, frozens, data_bits + codeword.mode);
+		decoded += flips >= 0;
+		if (result[0] != flips || batch.path[0] != reference.path || std::memcmp(message, expected, bytes))
+			++failed;
+	}
+	printf("single sigma %.2f: %d of %d decoded, %d differ from PolarDecoder\n", sigma, decoded, trials, failed);
+	return failed;
+}
+
+// shorter lists per group, but every group must decode the same in any lane position and never to a wrong message
+template <int GROUPS>
+static int grouped(int trials, float sigma) {
+	static BatchPolarDecoder<int8_t, GROUPS> batch;
+	int failed = 0, decoded = 0;
+	for (int t = 0; t < trials; ++t) {
+		Codeword codewords[GROUPS];
+		for (Codeword &codeword: codewords)
+			transmit(codeword, sigma);
+		int result[2][GROUPS];
+		uint8_t message[2][GROUPS][170] = {};
+		for (int rotate = 0; rotate < 2; ++rotate) {
+			uint8_t *messages[GROUPS];
+			const int8_t *codes[GROUPS];
+			const uint32_t *frozens[GROUPS];
+			int bits[GROUPS];
+			for (int g = 0; g < GROUPS; ++g) {
+				Codeword &codeword = codewords[(g + rotate) % GROUPS];
+				messages[g] = message[rotate][(g + rotate) % GROUPS];
+				codes[g] = codeword.code;
+				frozens[g] = frozen[codeword.mode];
+				bits[g] = data_bits[codeword.mode];
+			}
+			int order[GROUPS];
+			batch(order, messages, codes, frozens, bits);
+			for (int g = 0; g < GROUPS; ++g)
+				result[rotate][(g + rotate) % GROUPS] = order[g];
+		}
+		for (int g = 0; g < GROUPS; ++g) {
+			int bytes = data_bits[codewords[g].mode] / 8;
+			bool okay = result[0][g] >= 0 && !std::memcmp(message[0][g], codewords[g].message, bytes);
+			decoded += okay;
+			if (result[0][g] != result[1][g] || std::memcmp(message[0][g], message[1][g], bytes) || (result[0][g] >= 0 && !okay) || (sigma <= 0.5f && !okay))
+				++failed;
+		}
+	}
+	printf("%d groups sigma %.2f: %d of %d decoded, %d inconsistent\n", GROUPS, sigma, decoded, GROUPS * trials, failed);
+	return failed;
+}
+
+int main() {
+#if defined(__AVX2__) && defined(__x86_64__)
+	if (!__builtin_cpu_supports("avx2")) {
+		printf("no AVX2 on this CPU, skipping\n");
+		return 77;
+	}
+#elif defined(__SSE4_1__) && defined(__x86_64__)
+	if (!__builtin_cpu_supports("sse4.1")) {
+		printf("no SSE4.1 on this CPU, skipping\n");
+		return 77;
+	}
+#endif
+	int failed = 0;
+	for (float sigma: {0.5f, 0.9f, 1.1f})
+		failed += single(60, sigma);
+	for (float sigma: {0.5f, 0.9f}) {
+		failed += grouped<2>(20, sigma);
+		failed += grouped<4>(10, sigma);
+	}
+	if (failed)
+		fprintf(stderr, "%d polar checks failed\n", failed);
+	return !!failed;
+}
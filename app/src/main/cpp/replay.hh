@@ -0,0 +1,39 @@
+/*
+Replay captured decoder input
+
+Copyright 2022 Ahmet Inan <inan@aicodix.de>
+*/
+
+#pragma once
+
+#include <cstdio>
+#include <cstring>
+#include <new>
+#include "decoder.hh"
+
+template<typename FUNC>
+bool replay(DecoderInterface *decoder, const char *path, CaptureHeader *header, FUNC func) {
+	FILE *file = fopen(path, "rb");
+	if (!file)
+		return false;
+	bool okay = fread(header, sizeof(CaptureHeader), 1, file) == 1
+		&& !std::memcmp(header->magic, "RGC1", 4)
+		&& header->rate == decoder->rate()
+		&& header->channels == (header->channel_select ? 2 : 1);
+	int extended_length = (1280 * decoder->rate() / 8000) * 9 / 8;
+	int16_t *audio = okay ? new(std::nothrow) int16_t[2 * extended_length] : nullptr;
+	if (audio) {
+		for (int i = 0, frames = header->frames + 4 * extended_length; i < frames; i += extended_length) {
+			int count = fread(audio, sizeof(int16_t) * header->channels, extended_length, file);
+			std::memset(audio + count * header->channels, 0, sizeof(int16_t) * header->channels * (extended_length - count));
+			if (!decoder->feed(audio, extended_length, header->channel_select))
+				continue;
+			for (int status = decoder->process(); status != STATUS_OKAY; status = decoder->process())
+				func(status);
+		}
+		delete[] audio;
+	}
+	fclose(file);
+	return audio != nullptr;
+}
+
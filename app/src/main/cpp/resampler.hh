@@ -0,0 +1,104 @@
+/*
+Rational resampler with polyphase filter
+
+Copyright 2022 Ahmet Inan <inan@aicodix.de>
+*/
+
+#pragma once
+
+#include <new>
+#include <algorithm>
+#include <numeric>
+#include "filter.hh"
+#include "window.hh"
+
+namespace DSP {
+
+template <typename TYPE>
+class Resampler
+{
+	typedef typename TYPE::value_type value_type;
+	value_type *coeffs = nullptr;
+	TYPE *history = nullptr;
+	int L = 1, M = 1, K = 0, pos = 0, phase = 0;
+public:
+	~Resampler()
+	{
+		delete[] coeffs;
+		delete[] history;
+	}
+	// nearly coprime rates would need huge polyphase tables, 240001 to 8000 Hz alone has 8000 phases
+	static const int max_phases = 1024, max_coeffs = 1 << 20;
+	// Kaiser with a = 2 gives about 66 dB over a transition of 4 / N,
+	// so the stopband starts at the Nyquist rate of the narrower side when the cutoff is at 0.45
+	static long long taps(int L, int M)
+	{
+		return (40LL * std::max(L, M) + L - 1) / L;
+	}
+	static bool supported(int in_rate, int out_rate)
+	{
+		if (in_rate <= 0 || out_rate <= 0)
+			return false;
+		int g = std::gcd(in_rate, out_rate);
+		int L = out_rate / g, M = in_rate / g;
+		return L <= max_phases && taps(L, M) * L <= max_coeffs;
+	}
+	bool setup(int in_rate, int out_rate)
+	{
+		if (!supported(in_rate, out_rate))
+			return false;
+		int g = std::gcd(in_rate, out_rate);
+		L = out_rate / g;
+		M = in_rate / g;
+		K = taps(L, M);
+		delete[] coeffs;
+		delete[] history;
+		coeffs = new(std::nothrow) value_type[K*L];
+		history = new(std::nothrow) TYPE[2*K];
+		if (!coeffs || !history)
+			return false;
+		int N = K * L;
+		Kaiser<value_type> win(2);
+		LowPass<value_type> lowpass(value_type(0.45) / std::max(L, M));
+		value_type sum(0);
+		for (int n = 0; n < N; ++n)
+			sum += win(n, N) * lowpass(n, N);
+		// phase p gets taps p, p+L, .. in reverse to match the history
+		for (int p = 0; p < L; ++p)
+			for (int k = 0; k < K; ++k)
+				coeffs[K*p+K-1-k] = L * win(p+k*L, N) * lowpass(p+k*L, N) / sum;
+		reset();
+		return true;
+	}
+	void reset()
+	{
+		for (int i = 0; i < 2*K; ++i)
+			history[i] = 0;
+		pos = 0;
+		phase = 0;
+	}
+	int max_output()
+	{
+		return (L + M - 1) / M;
+	}
+	// consumes one input sample, returns the number of samples written to output
+	int operator()(TYPE *output, TYPE input)
+	{
+		history[pos] = history[pos+K] = input;
+		pos = (pos + 1) % K;
+		int count = 0;
+		for (; phase < L; phase += M) {
+			const value_type *c = coeffs + K * phase;
+			const TYPE *h = history + pos;
+			TYPE sum(0);
+			for (int k = 0; k < K; ++k)
+				sum += c[k] * h[k];
+			output[count++] = sum;
+		}
+		phase -= L;
+		return count;
+	}
+};
+
+}
+
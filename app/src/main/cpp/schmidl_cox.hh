@@ -8,9 +8,17 @@ Copyright 2021 Ahmet Inan <inan@aicodix.de>
 
 #include "fft.hh"
 #include "sma.hh"
+#include "swa.hh"
+#include "simd.hh"
+#include "delay.hh"
 #include "phasor.hh"
 #include "trigger.hh"
 
+struct SyncPeak {
+	int sample, index;
+	float phase;
+};
+
 template<typename value, typename cmplx, int search_pos, int symbol_len, int guard_len>
 class SchmidlCox {
 	typedef DSP::Const<value> Const;
@@ -21,11 +29,11 @@ class SchmidlCox {
 	DSP::SMA4<cmplx, value, symbol_len, false> cor;
 	DSP::SMA4<value, value, 2 * symbol_len, false> pwr;
 	DSP::SMA4<value, value, match_len, false> match;
-	DSP::Delay<value, match_del> align;
+	DSP::Delay<cmplx, match_del> align;
 	DSP::SchmittTrigger<value> threshold;
 	DSP::FallingEdgeTrigger falling;
 	cmplx tmp0[symbol_len], tmp1[symbol_len];
-	cmplx kern[symbol_len];
+	const cmplx *kern;
 	value timing_max = 0;
 	value phase_max = 0;
 	int index_max = 0;
@@ -45,22 +53,42 @@ class SchmidlCox {
 
 public:
 	int symbol_pos = 0;
+	int pos_err = 0;
 	value cfo_rad = 0;
 	value frac_cfo = 0;
 
-	SchmidlCox(const cmplx *sequence) : threshold(value(0.17 * match_len), value(0.19 * match_len)) {
+	static void kernel(cmplx *kern, const cmplx *sequence) {
+		DSP::FastFourierTransform<symbol_len, cmplx, -1> fwd;
 		fwd(kern, sequence);
 		for (int i = 0; i < symbol_len; ++i)
 			kern[i] = conj(kern[i]) / value(symbol_len);
 	}
 
+	SchmidlCox(const cmplx *kernel) : threshold(value(0.17 * match_len), value(0.19 * match_len)), kern(kernel) {}
+
+	void reset() {
+		cor.reset();
+		pwr.reset();
+		match.reset();
+		align.reset();
+		threshold.reset();
+		falling.reset();
+		timing_max = 0;
+		phase_max = 0;
+		index_max = 0;
+		symbol_pos = 0;
+		pos_err = 0;
+		cfo_rad = 0;
+		frac_cfo = 0;
+	}
+
 	bool operator()(const cmplx *samples) {
 		cmplx P = cor(samples[search_pos + symbol_len] * conj(samples[search_pos + 2 * symbol_len]));
 		value R = value(0.5) * pwr(norm(samples[search_pos + 2 * symbol_len]));
 		value min_R = 0.00001 * symbol_len;
 		R = std::max(R, min_R);
 		value timing = match(norm(P) / (R * R));
-		value phase = align(arg(P));
+		cmplx aligned = align(P);
 
 		bool collect = threshold(timing);
 		bool process = falling(collect);
@@ -70,7 +98,7 @@ public:
 
 		if (timing_max < timing) {
 			timing_max = timing;
-			phase_max = phase;
+			phase_max = arg(aligned);
 			index_max = match_del;
 		} else if (index_max < symbol_len + guard_len + match_del) {
 			++index_max;
@@ -79,13 +107,19 @@ public:
 		if (!process)
 			return false;
 
-		frac_cfo = phase_max / value(symbol_len);
+		value phase = phase_max;
+		int index = index_max;
+		index_max = 0;
+		timing_max = 0;
+		return refine(samples, phase, index);
+	}
+
+	bool refine(const cmplx *samples, value phase, int index) {
+		frac_cfo = phase / value(symbol_len);
 
 		DSP::Phasor<cmplx> osc;
 		osc.omega(frac_cfo);
-		symbol_pos = search_pos - index_max;
-		index_max = 0;
-		timing_max = 0;
+		symbol_pos = search_pos - index;
 		for (int i = 0; i < symbol_len; ++i)
 			tmp1[i] = samples[i + symbol_pos + symbol_len] * osc();
 		fwd(tmp0, tmp1);
@@ -116,7 +150,7 @@ public:
 		if (peak <= next * 4)
 			return false;
 
-		int pos_err = std::nearbyint(arg(tmp1[shift]) * symbol_len / Const::TwoPi());
+		pos_err = std::nearbyint(arg(tmp1[shift]) * symbol_len / Const::TwoPi());
 		if (abs(pos_err) > guard_len / 2)
 			return false;
 		symbol_pos -= pos_err;
@@ -127,3 +161,99 @@ public:
 		return true;
 	}
 };
+
+// timing metric of SchmidlCox for one stream per lane, peaks are refined per stream
+template<typename value, typename cmplx, int lanes, int search_pos, int symbol_len, int guard_len, int buffer_len>
+class SchmidlCoxLanes {
+	typedef SIMD<value, lanes> simd;
+	typedef decltype(vmask(simd())) mask;
+	static_assert(lanes < 32, "lanes do not fit into bit mask");
+	static const int match_len = guard_len | 1;
+	static const int match_del = (match_len - 1) / 2;
+	struct Pair {
+		simd re, im;
+	};
+	struct Add {
+		simd operator()(simd a, simd b) {
+			return vadd(a, b);
+		}
+	};
+	DSP::Delay<Pair, buffer_len - 1 - search_pos - 2 * symbol_len> newer;
+	DSP::Delay<Pair, symbol_len> older;
+	DSP::SWA<simd, Add, symbol_len> cor_re, cor_im;
+	DSP::SWA<simd, Add, 2 * symbol_len> pwr;
+	DSP::SWA<simd, Add, match_len> match;
+	DSP::Delay<Pair, match_del> align;
+	mask previous;
+	value timing_max[lanes];
+	value phase_max[lanes];
+	int index_max[lanes];
+
+	static Pair zero() {
+		return {vzero<simd>(), vzero<simd>()};
+	}
+
+public:
+	value phase[lanes];
+	int index[lanes];
+
+	SchmidlCoxLanes() : newer(zero()), older(zero()), cor_re(vzero<simd>()), cor_im(vzero<simd>()), pwr(vzero<simd>()), match(vzero<simd>()), align(zero()) {
+		reset();
+	}
+
+	void reset() {
+		newer.reset(zero());
+		older.reset(zero());
+		cor_re.reset(vzero<simd>());
+		cor_im.reset(vzero<simd>());
+		pwr.reset(vzero<simd>());
+		match.reset(vzero<simd>());
+		align.reset(zero());
+		previous = vzero<mask>();
+		for (int k = 0; k < lanes; ++k) {
+			timing_max[k] = 0;
+			phase_max[k] = 0;
+			index_max[k] = 0;
+		}
+	}
+
+	// returns a bit mask of the lanes that found a peak for SchmidlCox::refine
+	int operator()(simd re, simd im) {
+		Pair b = newer({re, im});
+		Pair a = older(b);
+		simd P_re = cor_re(vadd(vmul(a.re, b.re), vmul(a.im, b.im)));
+		simd P_im = cor_im(vsub(vmul(a.im, b.re), vmul(a.re, b.im)));
+		simd R = vmul(vdup<simd>(0.5), pwr(vadd(vmul(b.re, b.re), vmul(b.im, b.im))));
+		value min_R = 0.00001 * symbol_len;
+		R = vmax(R, vdup<simd>(min_R));
+		simd timing = match(vdiv(vadd(vmul(P_re, P_re), vmul(P_im, P_im)), vmul(R, R)));
+		Pair aligned = align({P_re, P_im});
+
+		mask low = vcgt(vdup<simd>(value(0.17 * match_len)), timing);
+		mask high = vcgt(timing, vdup<simd>(value(0.19 * match_len)));
+		mask collect = vorr(vand(previous, vnot(low)), vand(vnot(previous), high));
+		mask process = vand(previous, vnot(collect));
+		previous = collect;
+
+		int found = 0;
+		for (int k = 0; k < lanes; ++k) {
+			if (!collect.v[k] && !process.v[k])
+				continue;
+			if (timing_max[k] < timing.v[k]) {
+				timing_max[k] = timing.v[k];
+				phase_max[k] = arg(cmplx(aligned.re.v[k], aligned.im.v[k]));
+				index_max[k] = match_del;
+			} else if (index_max[k] < symbol_len + guard_len + match_del) {
+				++index_max[k];
+			}
+			if (!process.v[k])
+				continue;
+			found |= 1 << k;
+			phase[k] = phase_max[k];
+			index[k] = index_max[k];
+			index_max[k] = 0;
+			timing_max[k] = 0;
+		}
+		return found;
+	}
+};
@@ -1243,6 +1243,24 @@ static inline SIMD<double, WIDTH> vmul(SIMD<double, WIDTH> a, SIMD<double, WIDTH
 	return tmp;
 }
 
+template <int WIDTH>
+static inline SIMD<float, WIDTH> vdiv(SIMD<float, WIDTH> a, SIMD<float, WIDTH> b)
+{
+	SIMD<float, WIDTH> tmp;
+	for (int i = 0; i < WIDTH; ++i)
+		tmp.v[i] = a.v[i] / b.v[i];
+	return tmp;
+}
+
+template <int WIDTH>
+static inline SIMD<double, WIDTH> vdiv(SIMD<double, WIDTH> a, SIMD<double, WIDTH> b)
+{
+	SIMD<double, WIDTH> tmp;
+	for (int i = 0; i < WIDTH; ++i)
+		tmp.v[i] = a.v[i] / b.v[i];
+	return tmp;
+}
+
 template <int WIDTH>
 static inline SIMD<int8_t, WIDTH> vmul(SIMD<int8_t, WIDTH> a, SIMD<int8_t, WIDTH> b)
 {
@@ -1495,6 +1513,35 @@ static inline SIMD<double, WIDTH> vshuf(SIMD<double, WIDTH> a, SIMD<uint64_t, WI
 	return tmp;
 }
 
+template <int WIDTH>
+static inline SIMD<int32_t, WIDTH> vcvtn(SIMD<float, WIDTH> a)
+{
+	SIMD<int32_t, WIDTH> tmp;
+	for (int i = 0; i < WIDTH; ++i)
+		tmp.v[i] = std::nearbyint(a.v[i]);
+	return tmp;
+}
+
+template <int WIDTH>
+static inline SIMD<float, WIDTH> vcvt(SIMD<int32_t, WIDTH> a)
+{
+	SIMD<float, WIDTH> tmp;
+	for (int i = 0; i < WIDTH; ++i)
+		tmp.v[i] = a.v[i];
+	return tmp;
+}
+
+template <int WIDTH>
+static inline SIMD<int16_t, 2 * WIDTH> vqmovn(SIMD<int32_t, WIDTH> a, SIMD<int32_t, WIDTH> b)
+{
+	SIMD<int16_t, 2 * WIDTH> tmp;
+	for (int i = 0; i < WIDTH; ++i)
+		tmp.v[i] = std::min<int32_t>(std::max<int32_t>(a.v[i], INT16_MIN), INT16_MAX);
+	for (int i = 0; i < WIDTH; ++i)
+		tmp.v[WIDTH + i] = std::min<int32_t>(std::max<int32_t>(b.v[i], INT16_MIN), INT16_MAX);
+	return tmp;
+}
+
 #if 1
 #ifdef __AVX2__
 #include "avx2.hh"
@@ -1509,3 +1556,97 @@ static inline SIMD<double, WIDTH> vshuf(SIMD<double, WIDTH> a, SIMD<uint64_t, WI
 #endif
 #endif
 
+// atan2 with |error| < 3e-7 rad, (0, 0) gives 0
+template <int WIDTH>
+static inline SIMD<float, WIDTH> vatan2(SIMD<float, WIDTH> y, SIMD<float, WIDTH> x)
+{
+	typedef SIMD<float, WIDTH> float_simd;
+	typedef SIMD<uint32_t, WIDTH> uint32_simd;
+	float_simd ax = vabs(x), ay = vabs(y);
+	float_simd hi = vmax(ax, ay), lo = vmin(ax, ay);
+	uint32_simd valid = vcgtz(hi);
+	float_simd a = vreinterpret<float_simd>(vand(valid, vreinterpret<uint32_simd>(vdiv(lo, hi))));
+	float_simd aa = vmul(a, a);
+	float_simd r = vdup<float_simd>(0.0028662257f);
+	r = vadd(vmul(r, aa), vdup<float_simd>(-0.0161657367f));
+	r = vadd(vmul(r, aa), vdup<float_simd>(0.0429096138f));
+	r = vadd(vmul(r, aa), vdup<float_simd>(-0.0752896400f));
+	r = vadd(vmul(r, aa), vdup<float_simd>(0.1065626393f));
+	r = vadd(vmul(r, aa), vdup<float_simd>(-0.1420889944f));
+	r = vadd(vmul(r, aa), vdup<float_simd>(0.1999355085f));
+	r = vadd(vmul(r, aa), vdup<float_simd>(-0.3333314528f));
+	r = vadd(vmul(vmul(r, aa), a), a);
+	r = vreinterpret<float_simd>(vbsl(vcgtz(vsub(ay, ax)),
+		vreinterpret<uint32_simd>(vsub(vdup<float_simd>(1.57079632679489661923f), r)),
+		vreinterpret<uint32_simd>(r)));
+	r = vreinterpret<float_simd>(vbsl(vcltz(x),
+		vreinterpret<uint32_simd>(vsub(vdup<float_simd>(3.14159265358979323846f), r)),
+		vreinterpret<uint32_simd>(r)));
+	return vcopysign(r, y);
+}
+
+// log2 with |error| < 3e-7 * max(1, |log2(x)|) for normal positive numbers, zero gives about -127
+template <int WIDTH>
+static inline SIMD<float, WIDTH> vlog2(SIMD<float, WIDTH> x)
+{
+	typedef SIMD<float, WIDTH> float_simd;
+	typedef SIMD<int32_t, WIDTH> int32_simd;
+	typedef SIMD<uint32_t, WIDTH> uint32_simd;
+	uint32_simd u = vreinterpret<uint32_simd>(x);
+	uint32_simd exp_mask = vreinterpret<uint32_simd>(vdup<int32_simd>(0x7f800000));
+	uint32_simd one = vreinterpret<uint32_simd>(vdup<float_simd>(1.f));
+	float_simd e = vmul(vcvt(vreinterpret<int32_simd>(vand(u, exp_mask))), vdup<float_simd>(1.f / 8388608.f));
+	float_simd m = vreinterpret<float_simd>(vorr(vbic(u, exp_mask), one));
+	uint32_simd big = vcgtz(vsub(m, vdup<float_simd>(1.41421356237309504880f)));
+	m = vreinterpret<float_simd>(vbsl(big, vreinterpret<uint32_simd>(vmul(m, vdup<float_simd>(0.5f))), vreinterpret<uint32_simd>(m)));
+	e = vreinterpret<float_simd>(vbsl(big, vreinterpret<uint32_simd>(vsub(e, vdup<float_simd>(126.f))), vreinterpret<uint32_simd>(vsub(e, vdup<float_simd>(127.f)))));
+	float_simd t = vdiv(vsub(m, vdup<float_simd>(1.f)), vadd(m, vdup<float_simd>(1.f)));
+	float_simd tt = vmul(t, t);
+	float_simd r = vdup<float_simd>(1.f / 7.f);
+	r = vadd(vmul(r, tt), vdup<float_simd>(1.f / 5.f));
+	r = vadd(vmul(r, tt), vdup<float_simd>(1.f / 3.f));
+	r = vadd(vmul(r, tt), vdup<float_simd>(1.f));
+	return vadd(e, vmul(vmul(r, t), vdup<float_simd>(2.88539008177792681472f)));
+}
+
+// log10 with the same bound as vlog2
+template <int WIDTH>
+static inline SIMD<float, WIDTH> vlog10(SIMD<float, WIDTH> x)
+{
+	return vmul(vlog2(x), vdup<SIMD<float, WIDTH>>(0.30102999566398119521f));
+}
+
+// sine and cosine with |error| < 1e-7 for |a| < 8192
+template <int WIDTH>
+static inline void vsincos(SIMD<float, WIDTH> *s, SIMD<float, WIDTH> *c, SIMD<float, WIDTH> a)
+{
+	typedef SIMD<float, WIDTH> float_simd;
+	typedef SIMD<int32_t, WIDTH> int32_simd;
+	typedef SIMD<uint32_t, WIDTH> uint32_simd;
+	int32_simd k = vcvtn(vmul(a, vdup<float_simd>(0.63661977236758134308f)));
+	float_simd kf = vcvt(k);
+	float_simd r = vsub(a, vmul(kf, vdup<float_simd>(1.5703125f)));
+	r = vsub(r, vmul(kf, vdup<float_simd>(4.837512969970703125e-4f)));
+	r = vsub(r, vmul(kf, vdup<float_simd>(7.54978995489188216e-8f)));
+	float_simd rr = vmul(r, r);
+	float_simd ps = vdup<float_simd>(1.f / 362880.f);
+	ps = vadd(vmul(ps, rr), vdup<float_simd>(-1.f / 5040.f));
+	ps = vadd(vmul(ps, rr), vdup<float_simd>(1.f / 120.f));
+	ps = vadd(vmul(ps, rr), vdup<float_simd>(-1.f / 6.f));
+	ps = vadd(vmul(vmul(ps, rr), r), r);
+	float_simd pc = vdup<float_simd>(-1.f / 3628800.f);
+	pc = vadd(vmul(pc, rr), vdup<float_simd>(1.f / 40320.f));
+	pc = vadd(vmul(pc, rr), vdup<float_simd>(-1.f / 720.f));
+	pc = vadd(vmul(pc, rr), vdup<float_simd>(1.f / 24.f));
+	pc = vadd(vmul(pc, rr), vdup<float_simd>(-1.f / 2.f));
+	pc = vadd(vmul(pc, rr), vdup<float_simd>(1.f));
+	uint32_simd q = vreinterpret<uint32_simd>(k);
+	uint32_simd swap = vcgtz(vreinterpret<int32_simd>(vand(q, vreinterpret<uint32_simd>(vdup<int32_simd>(1)))));
+	uint32_simd sign = vreinterpret<uint32_simd>(vdup<int32_simd>(0x80000000));
+	uint32_simd sin_neg = vand(vcgtz(vreinterpret<int32_simd>(vand(q, vreinterpret<uint32_simd>(vdup<int32_simd>(2))))), sign);
+	uint32_simd cos_neg = vand(vcgtz(vreinterpret<int32_simd>(vand(vreinterpret<uint32_simd>(vadd(k, vdup<int32_simd>(1))), vreinterpret<uint32_simd>(vdup<int32_simd>(2))))), sign);
+	uint32_simd us = vreinterpret<uint32_simd>(ps), uc = vreinterpret<uint32_simd>(pc);
+	*s = vreinterpret<float_simd>(veor(vbsl(swap, uc, us), sin_neg));
+	*c = vreinterpret<float_simd>(veor(vbsl(swap, us, uc), cos_neg));
+}
+
@@ -0,0 +1,155 @@
+/*
+Error bounds of the approximate SIMD math against the standard library
+
+Copyright 2022 Ahmet Inan <inan@aicodix.de>
+*/
+
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <algorithm>
+#include "simd.hh"
+#include "xorshift.hh"
+
+#ifdef __AVX2__
+typedef SIMD<float, 8> float_simd;
+#else
+typedef SIMD<float, 4> float_simd;
+#endif
+
+static const int trials = 1 << 21;
+
+static CODE::Xorshift32 prng;
+
+static float uniform(float lo, float hi) {
+	return lo + (hi - lo) * (prng() / 4294967296.f);
+}
+
+// random sign, mantissa and an exponent between lo and hi
+static float scaled(int lo, int hi) {
+	return std::ldexp(uniform(-1, 1), lo + int(prng() % (hi - lo + 1)));
+}
+
+static float_simd load(const float *values) {
+	float_simd a;
+	std::memcpy(&a, values, sizeof(a));
+	return a;
+}
+
+static double ulp(float value) {
+	return std::ldexp(1., std::ilogb(value) - 23);
+}
+
+// model of the ARMv7 vdiv, which has no vector division and refines the 8 bit VRECPE estimate with two VRECPS steps
+static float recpe(float b) {
+	int e;
+	float m = std::frexp(std::abs(b), &e);
+	int a = 2 * int(m * 512) + 1;
+	int r = ((1 << 19) / a + 1) / 2;
+	return std::copysign(std::ldexp(r / 256.f, -e), b);
+}
+
+static float recps(float a, float b) {
+	volatile float product = a * b;
+	return 2.f - product;
+}
+
+static float armv7_div(float a, float b) {
+	float r = recpe(b);
+	r = recps(b, r) * r;
+	r = recps(b, r) * r;
+	return a * r;
+}
+
+// model of the ARMv7 vcvtn, which has to round to nearest even from the truncating VCVT
+static int32_t armv7_cvtn(float a) {
+	int32_t t = a >= 2147483648.f ? INT32_MAX : a <= -2147483648.f ? INT32_MIN : int32_t(a);
+	volatile float f = a - float(t);
+	bool away = std::abs(f) > 0.5f || (std::abs(f) == 0.5f && (t & 1));
+	int64_t sum = int64_t(t) + (away ? (std::signbit(f) ? -1 : 1) : 0);
+	return std::clamp<int64_t>(sum, INT32_MIN, INT32_MAX);
+}
+
+// errors of vdiv are in units in the last place, of vlog2 and vlog10 relative to max(1, |result|),
+// of vcvtn they count the results that differ from nearbyint
+static bool check(const char *name, double error, double bound) {
+	bool okay = error < bound;
+	printf("%-8s max error %.3g bound %.3g %s\n", name, error, bound, okay ? "okay" : "FAIL");
+	return okay;
+}
+
+int main() {
+#if defined(__AVX2__) && defined(__x86_64__)
+	if (!__builtin_cpu_supports("avx2")) {
+		printf("no AVX2 on this CPU, skipping\n");
+		return 77;
+	}
+#elif defined(__SSE4_1__) && defined(__x86_64__)
+	if (!__builtin_cpu_supports("sse4.1")) {
+		printf("no SSE4.1 on this CPU, skipping\n");
+		return 77;
+	}
+#endif
+	const int N = float_simd::SIZE;
+	float x[N], y[N], s[N], c[N];
+	int cvtn_miss = 0, armv7_cvtn_miss = 0;
+	double div_ulp = 0, armv7_ulp = 0, atan2_err = 0, log2_err = 0, log10_err = 0, sin_err = 0, cos_err = 0;
+	for (int t = 0; t < trials; t += N) {
+		for (int i = 0; i < N; ++i) {
+			x[i] = scaled(-40, 40);
+			y[i] = scaled(-40, 40);
+		}
+		float_simd q = vdiv(load(y), load(x));
+		for (int i = 0; i < N; ++i) {
+			float exact = y[i] / x[i];
+			div_ulp = std::max(div_ulp, std::abs(double(q.v[i]) - exact) / ulp(exact));
+			armv7_ulp = std::max(armv7_ulp, std::abs(double(armv7_div(y[i], x[i])) - exact) / ulp(exact));
+		}
+		float_simd a = vatan2(load(y), load(x));
+		for (int i = 0; i < N; ++i)
+			atan2_err = std::max(atan2_err, std::abs(a.v[i] - std::atan2(double(y[i]), double(x[i]))));
+		for (int i = 0; i < N; ++i) {
+			uint32_t bits = (1 + prng() % 254) << 23 | (prng() & 0x7fffff);
+			std::memcpy(x + i, &bits, sizeof(bits));
+		}
+		float_simd l2 = vlog2(load(x)), l10 = vlog10(load(x));
+		for (int i = 0; i < N; ++i) {
+			double exact2 = std::log2(double(x[i])), exact10 = std::log10(double(x[i]));
+			log2_err = std::max(log2_err, std::abs(l2.v[i] - exact2) / std::max(1., std::abs(exact2)));
+			log10_err = std::max(log10_err, std::abs(l10.v[i] - exact10) / std::max(1., std::abs(exact10)));
+		}
+		for (int i = 0; i < N; ++i)
+			x[i] = t & N ? uniform(-8192, 8192) : uniform(-4, 4);
+		// every other round on exact ties, the encoder clamps to int16 before converting
+		for (int i = 0; i < N; ++i)
+			y[i] = t & 2 * N ? std::nearbyint(uniform(-32768, 32767)) + 0.5f : uniform(-32768, 32767);
+		auto n = vcvtn(load(y));
+		for (int i = 0; i < N; ++i) {
+			cvtn_miss += n.v[i] != std::nearbyint(y[i]);
+			armv7_cvtn_miss += armv7_cvtn(y[i]) != std::nearbyint(y[i]);
+		}
+		float_simd vs, vc;
+		vsincos(&vs, &vc, load(x));
+		std::memcpy(s, &vs, sizeof(s));
+		std::memcpy(c, &vc, sizeof(c));
+		for (int i = 0; i < N; ++i) {
+			sin_err = std::max(sin_err, std::abs(s[i] - std::sin(double(x[i]))));
+			cos_err = std::max(cos_err, std::abs(c[i] - std::cos(double(x[i]))));
+		}
+	}
+	float zero[N] = {0};
+	float_simd origin = vatan2(load(zero), load(zero));
+	bool okay = true;
+	okay &= check("vdiv", div_ulp, 0.5);
+	okay &= check("vdiv v7", armv7_ulp, 3.5);
+	okay &= check("vatan2", atan2_err, 3e-7);
+	okay &= check("vlog2", log2_err, 3e-7);
+	okay &= check("vlog10", log10_err, 3e-7);
+	okay &= check("vsin", sin_err, 1e-7);
+	okay &= check("vcos", cos_err, 1e-7);
+	okay &= check("origin", std::abs(origin.v[0]), 1e-30);
+	okay &= check("vcvtn", cvtn_miss, 0.5);
+	okay &= check("vcvtn v7", armv7_cvtn_miss, 0.5);
+	return !okay;
+}
@@ -87,6 +87,10 @@ public:
 	SMA4() : swa(0)
 	{
 	}
+	void reset()
+	{
+		swa.reset(0);
+	}
 	TYPE operator () (TYPE input)
 	{
 		if (NORM)
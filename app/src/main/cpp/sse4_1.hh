@@ -470,6 +470,22 @@ inline SIMD<double, 2> vmul(SIMD<double, 2> a, SIMD<double, 2> b)
 	return tmp;
 }
 
+template <>
+inline SIMD<float, 4> vdiv(SIMD<float, 4> a, SIMD<float, 4> b)
+{
+	SIMD<float, 4> tmp;
+	tmp.m = _mm_div_ps(a.m, b.m);
+	return tmp;
+}
+
+template <>
+inline SIMD<double, 2> vdiv(SIMD<double, 2> a, SIMD<double, 2> b)
+{
+	SIMD<double, 2> tmp;
+	tmp.m = _mm_div_pd(a.m, b.m);
+	return tmp;
+}
+
 template <>
 inline SIMD<float, 4> vabs(SIMD<float, 4> a)
 {
@@ -1163,3 +1179,27 @@ inline SIMD<int8_t, 16> vshuf(SIMD<int8_t, 16> a, SIMD<uint8_t, 16> b)
 	return tmp;
 }
 
+template <>
+inline SIMD<int32_t, 4> vcvtn(SIMD<float, 4> a)
+{
+	SIMD<int32_t, 4> tmp;
+	tmp.m = _mm_cvtps_epi32(a.m);
+	return tmp;
+}
+
+template <>
+inline SIMD<float, 4> vcvt(SIMD<int32_t, 4> a)
+{
+	SIMD<float, 4> tmp;
+	tmp.m = _mm_cvtepi32_ps(a.m);
+	return tmp;
+}
+
+template <>
+inline SIMD<int16_t, 8> vqmovn(SIMD<int32_t, 4> a, SIMD<int32_t, 4> b)
+{
+	SIMD<int16_t, 8> tmp;
+	tmp.m = _mm_packs_epi32(a.m, b.m);
+	return tmp;
+}
+
@@ -16,9 +16,14 @@ class SWA
 	OP op;
 public:
 	SWA(TYPE ident) : leaf(NUM)
+	{
+		reset(ident);
+	}
+	void reset(TYPE ident)
 	{
 		for (int i = 0; i < 2 * NUM; ++i)
 			tree[i] = ident;
+		leaf = NUM;
 	}
 	TYPE operator () (TYPE input)
 	{
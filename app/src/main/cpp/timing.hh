@@ -0,0 +1,92 @@
+/*
+Lightweight per-stage timing
+
+Copyright 2022 Ahmet Inan <inan@aicodix.de>
+*/
+
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+
+#if defined(ENABLE_TRACING) && !defined(ENABLE_TIMING)
+#define ENABLE_TIMING
+#endif
+
+#ifdef ENABLE_TRACING
+#include "trace.hh"
+#endif
+
+template <int STAGES>
+class Timing
+{
+#ifdef ENABLE_TIMING
+	typedef std::chrono::steady_clock clock;
+	const char *const *names;
+	int64_t calls[STAGES], total[STAGES], worst[STAGES];
+public:
+	class Scope
+	{
+		Timing *timing;
+		int stage;
+		clock::time_point start;
+	public:
+		Scope(Timing *timing, int stage) : timing(timing), stage(stage), start(clock::now()) {}
+		Scope(const Scope &) = delete;
+		~Scope()
+		{
+			clock::time_point stop = clock::now();
+			int64_t nanos = std::chrono::duration_cast<std::chrono::nanoseconds>(stop - start).count();
+			++timing->calls[stage];
+			timing->total[stage] += nanos;
+			if (timing->worst[stage] < nanos)
+				timing->worst[stage] = nanos;
+#ifdef ENABLE_TRACING
+			int64_t begin = std::chrono::duration_cast<std::chrono::nanoseconds>(start.time_since_epoch()).count();
+			Trace::complete(timing->names[stage], begin, begin + nanos);
+#endif
+		}
+	};
+	Timing(const char *const *names) : names(names)
+	{
+		reset();
+	}
+	Scope operator()(int stage)
+	{
+		return Scope(this, stage);
+	}
+	void read(int64_t *stats)
+	{
+		for (int i = 0; i < STAGES; ++i) {
+			stats[3*i] = calls[i];
+			stats[3*i+1] = total[i];
+			stats[3*i+2] = worst[i];
+		}
+	}
+	void reset()
+	{
+		for (int i = 0; i < STAGES; ++i)
+			calls[i] = total[i] = worst[i] = 0;
+	}
+#else
+public:
+	struct Scope
+	{
+		~Scope() {}
+	};
+	Timing(const char *const *) {}
+	Scope operator()(int)
+	{
+		return Scope();
+	}
+	void read(int64_t *stats)
+	{
+		for (int i = 0; i < 3*STAGES; ++i)
+			stats[i] = 0;
+	}
+	void reset()
+	{
+	}
+#endif
+};
+
@@ -0,0 +1,115 @@
+/*
+Chrome trace event recording
+
+Copyright 2022 Ahmet Inan <inan@aicodix.de>
+*/
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdint>
+#include <new>
+
+namespace Trace {
+
+struct Event
+{
+	const char *name;
+	int64_t begin, end;
+};
+
+class Buffer
+{
+	static const uint32_t capacity = 1 << 16;
+	Event events[capacity];
+	std::atomic<uint32_t> head{0}, tail{0};
+public:
+	Buffer *next = nullptr;
+	int tid = 0;
+	std::atomic<uint32_t> dropped{0};
+
+	void push(const char *name, int64_t begin, int64_t end)
+	{
+		uint32_t h = head.load(std::memory_order_relaxed);
+		if (h - tail.load(std::memory_order_acquire) >= capacity) {
+			dropped.fetch_add(1, std::memory_order_relaxed);
+			return;
+		}
+		events[h % capacity] = {name, begin, end};
+		head.store(h + 1, std::memory_order_release);
+	}
+	template <typename FUNC>
+	void drain(FUNC func)
+	{
+		uint32_t t = tail.load(std::memory_order_relaxed);
+		uint32_t h = head.load(std::memory_order_acquire);
+		for (; t != h; ++t)
+			func(events[t % capacity]);
+		tail.store(t, std::memory_order_release);
+	}
+};
+
+inline std::atomic<Buffer *> buffers{nullptr};
+inline std::atomic<int> threads{0};
+
+inline int64_t now()
+{
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// buffers are never freed, so flush() can still drain them after their thread is gone
+inline Buffer *local()
+{
+	static thread_local Buffer *buffer = nullptr;
+	if (!buffer) {
+		buffer = new(std::nothrow) Buffer;
+		if (!buffer)
+			return nullptr;
+		buffer->tid = ++threads;
+		buffer->next = buffers.load(std::memory_order_relaxed);
+		while (!buffers.compare_exchange_weak(buffer->next, buffer, std::memory_order_release, std::memory_order_relaxed));
+	}
+	return buffer;
+}
+
+inline void complete(const char *name, int64_t begin, int64_t end)
+{
+	if (Buffer *buffer = local())
+		buffer->push(name, begin, end);
+}
+
+inline void instant(const char *name)
+{
+	complete(name, now(), -1);
+}
+
+// call from one thread at a time, writers may keep recording meanwhile
+inline bool flush(const char *path)
+{
+	FILE *file = fopen(path, "w");
+	if (!file)
+		return false;
+	fprintf(file, "{\"traceEvents\":[");
+	const char *separator = "\n";
+	for (Buffer *buffer = buffers.load(std::memory_order_acquire); buffer; buffer = buffer->next) {
+		buffer->drain([&](const Event &event) {
+			if (event.end < 0)
+				fprintf(file, "%s{\"name\":\"%s\",\"ph\":\"i\",\"s\":\"t\",\"ts\":%.3f,\"pid\":1,\"tid\":%d}",
+					separator, event.name, event.begin / 1000.0, buffer->tid);
+			else
+				fprintf(file, "%s{\"name\":\"%s\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":1,\"tid\":%d}",
+					separator, event.name, event.begin / 1000.0, (event.end - event.begin) / 1000.0, buffer->tid);
+			separator = ",\n";
+		});
+		if (uint32_t dropped = buffer->dropped.exchange(0, std::memory_order_relaxed))
+			fprintf(file, "%s{\"name\":\"dropped %u\",\"ph\":\"i\",\"s\":\"t\",\"ts\":%.3f,\"pid\":1,\"tid\":%d}",
+				separator, dropped, now() / 1000.0, buffer->tid);
+	}
+	fprintf(file, "\n]}\n");
+	return !fclose(file);
+}
+
+}
+
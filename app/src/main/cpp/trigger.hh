@@ -20,6 +20,10 @@ public:
 	constexpr SchmittTrigger(TYPE low, TYPE high, bool previous = false) : low(low), high(high), previous(previous)
 	{
 	}
+	void reset(bool value = false)
+	{
+		previous = value;
+	}
 	bool operator() (TYPE input)
 	{
 		if (previous) {
@@ -40,6 +44,10 @@ public:
 	constexpr FallingEdgeTrigger(bool previous = false) : previous(previous)
 	{
 	}
+	void reset(bool value = false)
+	{
+		previous = value;
+	}
 	bool operator() (bool input)
 	{
 		bool tmp = previous;
@@ -55,6 +63,10 @@ public:
 	constexpr RisingEdgeTrigger(bool previous = false) : previous(previous)
 	{
 	}
+	void reset(bool value = false)
+	{
+		previous = value;
+	}
 	bool operator() (bool input)
 	{
 		bool tmp = previous;
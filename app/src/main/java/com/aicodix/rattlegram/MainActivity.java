@@ -89,11 +89,14 @@ public class MainActivity extends AppCompatActivity {
 	private AudioRecord audioRecord;
 	private AudioTrack audioTrack;
 	private boolean fancyHeader;
+	private boolean fixedPoint;
 	private boolean repeaterMode;
 	private boolean showSpectrum;
 	private boolean ultrasonicEnabled;
 	private int spectrumTint;
 	private int noiseSymbols;
+	private int paprIterations;
+	private int hypothesisThreads;
 	private int repeaterDelay;
 	private int repeaterDebounce;
 	private int recordRate;
@@ -113,16 +116,20 @@ public class MainActivity extends AppCompatActivity {
 	private ArrayAdapter<String> messages;
 	private float[] stagedCFO;
 	private int[] stagedMode;
+	private float[] paprRatio;
+	private long[] paprNanoseconds;
 	private byte[] stagedCall;
 	private String callSign;
 	private String draftText;
 
 	private native boolean createEncoder(int sampleRate);
 
-	private native void configureEncoder(byte[] payload, byte[] callSign, int carrierFrequency, int noiseSymbols, boolean fancyHeader);
+	private native void configureEncoder(byte[] payload, byte[] callSign, int carrierFrequency, int noiseSymbols, boolean fancyHeader, int paprIterations);
 
 	private native boolean produceEncoder(short[] audioBuffer, int channelSelect);
 
+	private native boolean paprEncoder(float[] ratio, long[] nanoseconds);
+
 	private native void destroyEncoder();
 
 	private final AudioTrack.OnPlaybackPositionUpdateListener outputListener = new AudioTrack.OnPlaybackPositionUpdateListener() {
@@ -137,7 +144,12 @@ public class MainActivity extends AppCompatActivity {
 				audioTrack.write(outputBuffer, 0, outputBuffer.length);
 			} else {
 				audioTrack.stop();
-				handler.postDelayed(() -> startListening(), 1000);
+				boolean papr = paprEncoder(paprRatio, paprNanoseconds) && paprRatio[0] > 0;
+				handler.postDelayed(() -> {
+					startListening();
+					if (papr)
+						paprStatus();
+				}, 1000);
 			}
 		}
 	};
@@ -179,7 +191,17 @@ public class MainActivity extends AppCompatActivity {
 
 	private native int fetchDecoder(byte[] payload);
 
-	private native boolean createDecoder(int sampleRate);
+	private native boolean timingDecoder(long[] stats, boolean reset);
+
+	private native boolean metricsDecoder(int[] eventCounts, float[] frameQuality, float[] carrierSnr, boolean reset);
+
+	private native boolean flushTrace(String path);
+
+	private native boolean captureDecoder(String directory, int triggers);
+
+	private native boolean hypothesesDecoder(int threads);
+
+	private native boolean createDecoder(int sampleRate, boolean fixedPoint);
 
 	private native void destroyDecoder();
 
@@ -194,7 +216,6 @@ public class MainActivity extends AppCompatActivity {
 			audioRecord.read(recordBuffer, 0, recordBuffer.length);
 			if (!feedDecoder(recordBuffer, recordCount, recordChannel))
 				return;
-			int status = processDecoder();
 			if (showSpectrum) {
 				spectrumDecoder(spectrumPixels, spectrogramPixels, spectrumTint);
 				spectrumBitmap.setPixels(spectrumPixels, 0, spectrumWidth, 0, 0, spectrumWidth, spectrumHeight);
@@ -209,42 +230,43 @@ public class MainActivity extends AppCompatActivity {
 			final int STATUS_HEAP = 4;
 			final int STATUS_NOPE = 5;
 			final int STATUS_PING = 6;
-			switch (status) {
-				case STATUS_OKAY:
-					break;
-				case STATUS_FAIL:
-					setStatus(getString(R.string.preamble_fail), true);
-					break;
-				case STATUS_NOPE:
-					stagedDecoder(stagedCFO, stagedMode, stagedCall);
-					fromStatus();
-					addLine(new String(stagedCall).trim(), getString(R.string.preamble_nope, stagedMode[0]));
-					break;
-				case STATUS_PING:
-					stagedDecoder(stagedCFO, stagedMode, stagedCall);
-					fromStatus();
-					addLine(new String(stagedCall).trim(), getString(R.string.preamble_ping));
-					break;
-				case STATUS_HEAP:
-					setStatus(getString(R.string.heap_error));
-					audioRecord.stop();
-					break;
-				case STATUS_SYNC:
-					stagedDecoder(stagedCFO, stagedMode, stagedCall);
-					fromStatus();
-					break;
-				case STATUS_DONE:
-					int result = fetchDecoder(payload);
-					if (result < 0) {
-						addLine(new String(stagedCall).trim(), getString(R.string.decoding_failed));
-					} else {
-						setStatus(getResources().getQuantityString(R.plurals.bits_flipped, result, result), true);
-						if (repeaterMode)
-							repeatMessage();
-						else
-							addMessage(new String(stagedCall).trim(), getString(R.string.received), new String(payload).trim());
-					}
-					break;
+			for (int status = processDecoder(); status != STATUS_OKAY; status = processDecoder()) {
+				switch (status) {
+					case STATUS_FAIL:
+						setStatus(getString(R.string.preamble_fail), true);
+						break;
+					case STATUS_NOPE:
+						stagedDecoder(stagedCFO, stagedMode, stagedCall);
+						fromStatus();
+						addLine(new String(stagedCall).trim(), getString(R.string.preamble_nope, stagedMode[0]));
+						break;
+					case STATUS_PING:
+						stagedDecoder(stagedCFO, stagedMode, stagedCall);
+						fromStatus();
+						addLine(new String(stagedCall).trim(), getString(R.string.preamble_ping));
+						break;
+					case STATUS_HEAP:
+						setStatus(getString(R.string.heap_error));
+						audioRecord.stop();
+						return;
+					case STATUS_SYNC:
+						stagedDecoder(stagedCFO, stagedMode, stagedCall);
+						fromStatus();
+						break;
+					case STATUS_DONE:
+						stagedDecoder(stagedCFO, stagedMode, stagedCall);
+						int result = fetchDecoder(payload);
+						if (result < 0) {
+							addLine(new String(stagedCall).trim(), getString(R.string.decoding_failed));
+						} else {
+							setStatus(getResources().getQuantityString(R.plurals.bits_flipped, result, result), true);
+							if (repeaterMode)
+								repeatMessage();
+							else
+								addMessage(new String(stagedCall).trim(), getString(R.string.received), new String(payload).trim());
+						}
+						break;
+				}
 			}
 		}
 	};
@@ -269,6 +291,10 @@ public class MainActivity extends AppCompatActivity {
 		setStatus(getString(R.string.from_status, new String(stagedCall).trim(), stagedMode[0], stagedCFO[0]), true);
 	}
 
+	private void paprStatus() {
+		setStatus(getString(R.string.papr_status, 10 * Math.log10(paprRatio[0]), paprNanoseconds[0] / 1000000.0), true);
+	}
+
 	private byte[] callTerm() {
 		return Arrays.copyOf(callSign.getBytes(StandardCharsets.US_ASCII), callSign.length() + 1);
 	}
@@ -332,7 +358,8 @@ public class MainActivity extends AppCompatActivity {
 		try {
 			AudioRecord testAudioRecord = new AudioRecord(audioSource, recordRate, channelConfig, audioFormat, bufferSize);
 			if (testAudioRecord.getState() == AudioRecord.STATE_INITIALIZED) {
-				if (createDecoder(recordRate)) {
+				if (createDecoder(recordRate, fixedPoint)) {
+					hypothesesDecoder(hypothesisThreads);
 					audioRecord = testAudioRecord;
 					recordCount = recordRate / 50;
 					recordBuffer = new short[recordCount * channelCount];
@@ -399,11 +426,14 @@ public class MainActivity extends AppCompatActivity {
 		state.putInt("audioSource", audioSource);
 		state.putInt("carrierFrequency", carrierFrequency);
 		state.putInt("noiseSymbols", noiseSymbols);
+		state.putInt("paprIterations", paprIterations);
+		state.putInt("hypothesisThreads", hypothesisThreads);
 		state.putInt("repeaterDelay", repeaterDelay);
 		state.putInt("repeaterDebounce", repeaterDebounce);
 		state.putString("callSign", callSign);
 		state.putString("draftText", draftText);
 		state.putBoolean("fancyHeader", fancyHeader);
+		state.putBoolean("fixedPoint", fixedPoint);
 		state.putBoolean("repeaterMode", repeaterMode);
 		for (int i = 0; i < messages.getCount(); ++i)
 			state.putString("m" + i, messages.getItem(i));
@@ -421,11 +451,14 @@ public class MainActivity extends AppCompatActivity {
 		edit.putInt("audioSource", audioSource);
 		edit.putInt("carrierFrequency", carrierFrequency);
 		edit.putInt("noiseSymbols", noiseSymbols);
+		edit.putInt("paprIterations", paprIterations);
+		edit.putInt("hypothesisThreads", hypothesisThreads);
 		edit.putInt("repeaterDelay", repeaterDelay);
 		edit.putInt("repeaterDebounce", repeaterDebounce);
 		edit.putString("callSign", callSign);
 		edit.putString("draftText", draftText);
 		edit.putBoolean("fancyHeader", fancyHeader);
+		edit.putBoolean("fixedPoint", fixedPoint);
 		edit.putBoolean("repeaterMode", repeaterMode);
 		for (int i = 0; i < messages.getCount(); ++i)
 			edit.putString("m" + i, messages.getItem(i));
@@ -440,11 +473,14 @@ public class MainActivity extends AppCompatActivity {
 		final int defaultAudioSource = MediaRecorder.AudioSource.DEFAULT;
 		final int defaultCarrierFrequency = 1500;
 		final int defaultNoiseSymbols = 6;
+		final int defaultPaprIterations = 1;
+		final int defaultHypothesisThreads = 0;
 		final int defaultRepeaterDelay = 1;
 		final int defaultRepeaterDebounce = 60;
 		final String defaultCallSign = "ANONYMOUS";
 		final String defaultDraftText = "";
 		final boolean defaultFancyHeader = false;
+		final boolean defaultFixedPoint = false;
 		final boolean defaultRepeaterMode = false;
 		if (state == null) {
 			SharedPreferences pref = getPreferences(Context.MODE_PRIVATE);
@@ -456,11 +492,14 @@ public class MainActivity extends AppCompatActivity {
 			audioSource = pref.getInt("audioSource", defaultAudioSource);
 			carrierFrequency = pref.getInt("carrierFrequency", defaultCarrierFrequency);
 			noiseSymbols = pref.getInt("noiseSymbols", defaultNoiseSymbols);
+			paprIterations = pref.getInt("paprIterations", defaultPaprIterations);
+			hypothesisThreads = pref.getInt("hypothesisThreads", defaultHypothesisThreads);
 			repeaterDelay = pref.getInt("repeaterDelay", defaultRepeaterDelay);
 			repeaterDebounce = pref.getInt("repeaterDebounce", defaultRepeaterDebounce);
 			callSign = pref.getString("callSign", defaultCallSign);
 			draftText = pref.getString("draftText", defaultDraftText);
 			fancyHeader = pref.getBoolean("fancyHeader", defaultFancyHeader);
+			fixedPoint = pref.getBoolean("fixedPoint", defaultFixedPoint);
 			repeaterMode = pref.getBoolean("repeaterMode", defaultRepeaterMode);
 			for (int i = 0; i < 100; ++i) {
 				String mesg = pref.getString("m" + i, null);
@@ -476,11 +515,14 @@ public class MainActivity extends AppCompatActivity {
 			audioSource = state.getInt("audioSource", defaultAudioSource);
 			carrierFrequency = state.getInt("carrierFrequency", defaultCarrierFrequency);
 			noiseSymbols = state.getInt("noiseSymbols", defaultNoiseSymbols);
+			paprIterations = state.getInt("paprIterations", defaultPaprIterations);
+			hypothesisThreads = state.getInt("hypothesisThreads", defaultHypothesisThreads);
 			repeaterDelay = state.getInt("repeaterDelay", defaultRepeaterDelay);
 			repeaterDebounce = state.getInt("repeaterDebounce", defaultRepeaterDebounce);
 			callSign = state.getString("callSign", defaultCallSign);
 			draftText = state.getString("draftText", defaultDraftText);
 			fancyHeader = state.getBoolean("fancyHeader", defaultFancyHeader);
+			fixedPoint = state.getBoolean("fixedPoint", defaultFixedPoint);
 			repeaterMode = state.getBoolean("repeaterMode", defaultRepeaterMode);
 			for (int i = 0; i < 100; ++i) {
 				String mesg = state.getString("m" + i, null);
@@ -498,6 +540,8 @@ public class MainActivity extends AppCompatActivity {
 		handleInsets();
 		stagedCFO = new float[1];
 		stagedMode = new int[1];
+		paprRatio = new float[1];
+		paprNanoseconds = new long[1];
 		stagedCall = new byte[10];
 		payload = new byte[170];
 		repeatedMessages = new ArrayList<>();
@@ -596,6 +640,76 @@ public class MainActivity extends AppCompatActivity {
 		}
 	}
 
+	private void setPaprIterations(int newPaprIterations) {
+		if (paprIterations == newPaprIterations)
+			return;
+		paprIterations = newPaprIterations;
+		updatePaprIterationsMenu();
+	}
+
+	private void updatePaprIterationsMenu() {
+		switch (paprIterations) {
+			case 0:
+				menu.findItem(R.id.action_disable_papr_reduction).setChecked(true);
+				break;
+			case 1:
+				menu.findItem(R.id.action_set_papr_one_pass).setChecked(true);
+				break;
+			case 2:
+				menu.findItem(R.id.action_set_papr_two_passes).setChecked(true);
+				break;
+			case 4:
+				menu.findItem(R.id.action_set_papr_four_passes).setChecked(true);
+				break;
+		}
+	}
+
+	private void setHypothesisThreads(int newHypothesisThreads) {
+		if (hypothesisThreads == newHypothesisThreads)
+			return;
+		hypothesisThreads = newHypothesisThreads;
+		updateHypothesisThreadsMenu();
+		if (audioRecord != null && !hypothesesDecoder(hypothesisThreads))
+			setStatus(getString(R.string.heap_error));
+	}
+
+	private void setFixedPoint(boolean newFixedPoint) {
+		if (fixedPoint == newFixedPoint)
+			return;
+		fixedPoint = newFixedPoint;
+		updateFixedPointMenu();
+		if (audioRecord == null)
+			return;
+		if (createDecoder(recordRate, fixedPoint))
+			hypothesesDecoder(hypothesisThreads);
+		else
+			setStatus(getString(R.string.heap_error));
+	}
+
+	private void updateFixedPointMenu() {
+		if (fixedPoint)
+			menu.findItem(R.id.action_enable_fixed_point).setChecked(true);
+		else
+			menu.findItem(R.id.action_disable_fixed_point).setChecked(true);
+	}
+
+	private void updateHypothesisThreadsMenu() {
+		switch (hypothesisThreads) {
+			case 0:
+				menu.findItem(R.id.action_disable_recovery).setChecked(true);
+				break;
+			case 1:
+				menu.findItem(R.id.action_set_recovery_one_thread).setChecked(true);
+				break;
+			case 2:
+				menu.findItem(R.id.action_set_recovery_two_threads).setChecked(true);
+				break;
+			case 4:
+				menu.findItem(R.id.action_set_recovery_four_threads).setChecked(true);
+				break;
+		}
+	}
+
 	private void setRepeaterDelay(int newRepeaterDelay) {
 		if (repeaterDelay == newRepeaterDelay)
 			return;
@@ -807,6 +921,9 @@ public class MainActivity extends AppCompatActivity {
 		updateRecordChannelMenu();
 		updateAudioSourceMenu();
 		updateNoiseSymbolsMenu();
+		updatePaprIterationsMenu();
+		updateHypothesisThreadsMenu();
+		updateFixedPointMenu();
 		updateRepeaterDelayMenu();
 		updateRepeaterDebounceMenu();
 		updateFancyHeaderMenu();
@@ -969,6 +1086,46 @@ public class MainActivity extends AppCompatActivity {
 			setNoiseSymbols(22);
 			return true;
 		}
+		if (id == R.id.action_disable_papr_reduction) {
+			setPaprIterations(0);
+			return true;
+		}
+		if (id == R.id.action_set_papr_one_pass) {
+			setPaprIterations(1);
+			return true;
+		}
+		if (id == R.id.action_set_papr_two_passes) {
+			setPaprIterations(2);
+			return true;
+		}
+		if (id == R.id.action_set_papr_four_passes) {
+			setPaprIterations(4);
+			return true;
+		}
+		if (id == R.id.action_disable_recovery) {
+			setHypothesisThreads(0);
+			return true;
+		}
+		if (id == R.id.action_set_recovery_one_thread) {
+			setHypothesisThreads(1);
+			return true;
+		}
+		if (id == R.id.action_set_recovery_two_threads) {
+			setHypothesisThreads(2);
+			return true;
+		}
+		if (id == R.id.action_set_recovery_four_threads) {
+			setHypothesisThreads(4);
+			return true;
+		}
+		if (id == R.id.action_enable_fixed_point) {
+			setFixedPoint(true);
+			return true;
+		}
+		if (id == R.id.action_disable_fixed_point) {
+			setFixedPoint(false);
+			return true;
+		}
 		if (id == R.id.action_set_repeater_no_delay) {
 			setRepeaterDelay(0);
 			return true;
@@ -1176,7 +1333,7 @@ public class MainActivity extends AppCompatActivity {
 			addLine(callSign.trim(), getString(R.string.sent_ping));
 		else
 			addMessage(callSign.trim(), getString(R.string.transmitted), new String(mesg).trim());
-		configureEncoder(mesg, callTerm(), carrierFrequency, noiseSymbols, fancyHeader);
+		configureEncoder(mesg, callTerm(), carrierFrequency, noiseSymbols, fancyHeader, paprIterations);
 		for (int i = 0; i < 5; ++i) {
 			produceEncoder(outputBuffer, outputChannel);
 			audioTrack.write(outputBuffer, 0, outputBuffer.length);
@@ -1203,7 +1360,7 @@ public class MainActivity extends AppCompatActivity {
 			repeatedMessages.add(message);
 		stopListening();
 		addMessage(new String(stagedCall).trim(), getString(R.string.repeated), new String(payload).trim());
-		configureEncoder(payload, stagedCall, carrierFrequency, noiseSymbols, fancyHeader);
+		configureEncoder(payload, stagedCall, carrierFrequency, noiseSymbols, fancyHeader, paprIterations);
 		for (int i = 0; i < 5; ++i) {
 			produceEncoder(outputBuffer, outputChannel);
 			audioTrack.write(outputBuffer, 0, outputBuffer.length);